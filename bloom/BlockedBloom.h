@@ -0,0 +1,285 @@
+/*
+ * Copyright (C) 2013 Christian Briones
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense, 
+ * and/or sell copies of the Software, and to permit persons to whom the 
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included 
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, 
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES 
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR
+ * ANY CLAIM, DAMAGES, OR OTHER LIABILITY, WHETHER IN AN ACTION OF
+ * CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+ * WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef BLOCKED_BLOOM_H
+#define BLOCKED_BLOOM_H
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <new>
+#include <string>
+
+#if __cplusplus >= 201703L
+#include <string_view>
+#endif
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+#include "../hashmap/Hash.h"
+
+/**
+ * Split-block Bloom filter: every key sets and tests its k = 8 bits within
+ * a single 256-bit block, one bit in each of the block's eight 32-bit
+ * words. The blocks start on a 64-byte cache line boundary, so a block
+ * never straddles a cache line and a query costs at most one cache miss,
+ * where Bloom takes one per hash function.
+ *
+ * One 64-bit hash per key picks the block with its high half, and each
+ * word's bit with its low half multiplied by a per-word odd constant. With
+ * AVX2 the eight bit positions are computed, and the block tested or
+ * updated, in a handful of vector instructions; with SSE2 alone, in two
+ * halves of four words.
+ *
+ * Confining the bits to a block costs some accuracy: at 10 bits per key
+ * the false positive rate is about 1.3%, against 0.8% for a standard
+ * Bloom filter with the best k.
+ */
+class BlockedBloom {
+public:
+    explicit BlockedBloom(size_t bits, uint64_t seed = hash_seed());
+    ~BlockedBloom();
+
+    BlockedBloom(const BlockedBloom& other);
+    BlockedBloom& operator=(const BlockedBloom& other);
+    BlockedBloom(BlockedBloom&& other) noexcept;
+    BlockedBloom& operator=(BlockedBloom&& other) noexcept;
+
+    void add(const void* data, size_t len){
+        add_hash(hash_bytes(data, len, seed_));
+    }
+    bool contains(const void* data, size_t len) const {
+        return contains_hash(hash_bytes(data, len, seed_));
+    }
+#if __cplusplus >= 201703L
+    void add(std::string_view key){
+        add(key.data(), key.size());
+    }
+    bool contains(std::string_view key) const {
+        return contains(key.data(), key.size());
+    }
+#else
+    void add(const std::string& key){
+        add(key.data(), key.size());
+    }
+    bool contains(const std::string& key) const {
+        return contains(key.data(), key.size());
+    }
+#endif
+
+    // For keys that have already been hashed, with seed()
+    void add_hash(uint64_t hash);
+    bool contains_hash(uint64_t hash) const;
+
+    void clear(){
+        memset(blocks_, 0, blockCount_ * sizeof(Block));
+    }
+    size_t bits() const {
+        return blockCount_ * 256;
+    }
+    uint64_t seed() const {
+        return seed_;
+    }
+private:
+    struct Block {
+        uint32_t words[8];
+    };
+
+    Block* blocks_;
+    size_t blockCount_;
+    uint64_t seed_;
+
+    static Block* allocate(size_t count);
+
+    size_t index(uint64_t hash) const {
+        return (static_cast<__uint128_t>(hash >> 32) * blockCount_) >> 32;
+    }
+    Block& block(uint64_t hash){
+        return blocks_[index(hash)];
+    }
+    const Block& block(uint64_t hash) const {
+        return blocks_[index(hash)];
+    }
+
+#if defined(__AVX2__)
+    /**
+     * The bit each word of the block must have set for a key.
+     */
+    static __m256i mask(uint32_t x){
+        const __m256i salts = _mm256_setr_epi32(
+                0x47b6137b, 0x44974d91, 0x8824ad5b, 0xa2b7289d,
+                0x705495c7, 0x2df1424b, 0x9efc4947, 0x5c6bfb31);
+        __m256i bit = _mm256_srli_epi32(_mm256_mullo_epi32(_mm256_set1_epi32(x), salts), 27);
+        return _mm256_sllv_epi32(_mm256_set1_epi32(1), bit);
+    }
+#elif defined(__SSE2__)
+    /**
+     * The bit each word of one half of the block must have set for a key.
+     * SSE2 has neither a 32-bit multiply nor a per-lane shift, so the
+     * products come from two 32x32->64 multiplies, and 1 << bit from
+     * truncating the float 2^bit. 2^31 is out of range and converts to
+     * 0x80000000, which is the bit wanted.
+     */
+    static __m128i mask(uint32_t x, int half){
+        alignas(16) static const uint32_t salts[8] = {
+                0x47b6137b, 0x44974d91, 0x8824ad5b, 0xa2b7289d,
+                0x705495c7, 0x2df1424b, 0x9efc4947, 0x5c6bfb31 };
+        __m128i key = _mm_set1_epi32(x);
+        __m128i salt = _mm_load_si128(reinterpret_cast<const __m128i*>(salts + 4 * half));
+        __m128i even = _mm_mul_epu32(key, salt);
+        __m128i odd = _mm_mul_epu32(key, _mm_srli_epi64(salt, 32));
+        __m128i product = _mm_unpacklo_epi32(_mm_shuffle_epi32(even, _MM_SHUFFLE(0, 0, 2, 0)),
+                _mm_shuffle_epi32(odd, _MM_SHUFFLE(0, 0, 2, 0)));
+        __m128i bit = _mm_srli_epi32(product, 27);
+        return _mm_cvttps_epi32(_mm_castsi128_ps(_mm_slli_epi32(_mm_add_epi32(bit, _mm_set1_epi32(127)), 23)));
+    }
+#else
+    static uint32_t mask(uint32_t x, int word){
+        static const uint32_t salts[8] = {
+                0x47b6137b, 0x44974d91, 0x8824ad5b, 0xa2b7289d,
+                0x705495c7, 0x2df1424b, 0x9efc4947, 0x5c6bfb31 };
+        return 1u << ((x * salts[word]) >> 27);
+    }
+#endif
+};
+
+/**
+ * Creates a filter of at least the given number of bits, rounded up to a
+ * whole number of blocks.
+ */
+inline BlockedBloom::BlockedBloom(size_t bits, uint64_t seed) :
+    blockCount_(bits > 256 ? (bits + 255) / 256 : 1),
+    seed_(seed)
+{
+    blocks_ = allocate(blockCount_);
+    clear();
+}
+
+inline BlockedBloom::~BlockedBloom(){
+    free(blocks_);
+}
+
+inline BlockedBloom::BlockedBloom(const BlockedBloom& other) :
+    blocks_(allocate(other.blockCount_)),
+    blockCount_(other.blockCount_),
+    seed_(other.seed_)
+{
+    memcpy(blocks_, other.blocks_, blockCount_ * sizeof(Block));
+}
+
+inline BlockedBloom& BlockedBloom::operator=(const BlockedBloom& other){
+    if (this != &other){
+        Block* blocks = allocate(other.blockCount_);
+        memcpy(blocks, other.blocks_, other.blockCount_ * sizeof(Block));
+        free(blocks_);
+        blocks_ = blocks;
+        blockCount_ = other.blockCount_;
+        seed_ = other.seed_;
+    }
+    return *this;
+}
+
+/**
+ * Takes over the blocks of other, which is left without any and may only
+ * be assigned to or destroyed.
+ */
+inline BlockedBloom::BlockedBloom(BlockedBloom&& other) noexcept :
+    blocks_(other.blocks_),
+    blockCount_(other.blockCount_),
+    seed_(other.seed_)
+{
+    other.blocks_ = nullptr;
+    other.blockCount_ = 0;
+}
+
+inline BlockedBloom& BlockedBloom::operator=(BlockedBloom&& other) noexcept {
+    if (this != &other){
+        free(blocks_);
+        blocks_ = other.blocks_;
+        blockCount_ = other.blockCount_;
+        seed_ = other.seed_;
+        other.blocks_ = nullptr;
+        other.blockCount_ = 0;
+    }
+    return *this;
+}
+
+/**
+ * Allocates count blocks on a cache line boundary.
+ */
+inline BlockedBloom::Block* BlockedBloom::allocate(size_t count){
+    // aligned_alloc wants a multiple of the alignment
+    size_t bytes = (count * sizeof(Block) + 63) / 64 * 64;
+    void* blocks = aligned_alloc(64, bytes);
+    if (!blocks){
+        throw std::bad_alloc();
+    }
+    return static_cast<Block*>(blocks);
+}
+
+inline void BlockedBloom::add_hash(uint64_t hash){
+    Block& b = block(hash);
+#if defined(__AVX2__)
+    __m256i* words = reinterpret_cast<__m256i*>(b.words);
+    _mm256_store_si256(words, _mm256_or_si256(_mm256_load_si256(words), mask(static_cast<uint32_t>(hash))));
+#elif defined(__SSE2__)
+    __m128i* words = reinterpret_cast<__m128i*>(b.words);
+    for (int half = 0; half < 2; half++){
+        _mm_store_si128(words + half, _mm_or_si128(_mm_load_si128(words + half), mask(static_cast<uint32_t>(hash), half)));
+    }
+#else
+    for (int i = 0; i < 8; i++){
+        b.words[i] |= mask(static_cast<uint32_t>(hash), i);
+    }
+#endif
+}
+
+inline bool BlockedBloom::contains_hash(uint64_t hash) const {
+    const Block& b = block(hash);
+#if defined(__AVX2__)
+    // testc is set when every bit of the mask is set in the block
+    return _mm256_testc_si256(_mm256_load_si256(reinterpret_cast<const __m256i*>(b.words)),
+            mask(static_cast<uint32_t>(hash)));
+#elif defined(__SSE2__)
+    // The bits of the masks missing from the block, all zero if present
+    const __m128i* words = reinterpret_cast<const __m128i*>(b.words);
+    __m128i missing = _mm_or_si128(
+            _mm_andnot_si128(_mm_load_si128(words), mask(static_cast<uint32_t>(hash), 0)),
+            _mm_andnot_si128(_mm_load_si128(words + 1), mask(static_cast<uint32_t>(hash), 1)));
+    return _mm_movemask_epi8(_mm_cmpeq_epi32(missing, _mm_setzero_si128())) == 0xFFFF;
+#else
+    // Without a branch per word, which would be mispredicted for most
+    // keys that are not present
+    uint32_t missing = 0;
+    for (int i = 0; i < 8; i++){
+        missing |= ~b.words[i] & mask(static_cast<uint32_t>(hash), i);
+    }
+    return missing == 0;
+#endif
+}
+
+#endif // BLOCKED_BLOOM_H
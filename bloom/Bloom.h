@@ -23,55 +23,420 @@
 #ifndef BLOOM_H
 #define BLOOM_H
 
-#include <bitset>
-#include <functional>
-#include <vector>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <new>
+#include <stdexcept>
 #include <string>
 
-typedef std::function<unsigned int (std::string)> HashFunc_t;
+#if __cplusplus >= 201703L
+#include <string_view>
+#endif
+
+#include "../hashmap/Hash.h"
+
+namespace bloom_detail {
+    struct Sizing {
+        size_t cells;
+        int hashes;
+    };
+
+    /**
+     * The optimal number of cells (bits, or counters) and hash functions for
+     * holding expected_items at a false positive rate of fpp:
+     *
+     *     m = -n ln(p) / ln(2)^2,    k = (m / n) ln(2)
+     *
+     * The cell count is rounded up to a multiple of round.
+     */
+    inline Sizing optimal_sizing(size_t expected_items, double fpp, size_t round){
+        if (!(fpp > 0 && fpp < 1)){
+            throw std::invalid_argument("Bloom: false positive rate must be between 0 and 1");
+        }
+        const double LN2 = std::log(2.0);
+        double n = expected_items > 0 ? expected_items : 1;
+        double m = std::ceil(-n * std::log(fpp) / (LN2 * LN2));
+
+        Sizing sizing;
+        sizing.cells = (static_cast<size_t>(m) + round - 1) / round * round;
+        sizing.hashes = std::max(1, static_cast<int>(std::round(m / n * LN2)));
+        return sizing;
+    }
+
+    /**
+     * Allocates count 64-bit words, which must be a whole number of cache
+     * lines, on a cache line boundary.
+     */
+    inline uint64_t* allocate_words(size_t count){
+        void* words = aligned_alloc(64, count * sizeof(uint64_t));
+        if (!words){
+            throw std::bad_alloc();
+        }
+        return static_cast<uint64_t*>(words);
+    }
 
-unsigned int sax_hash(std::string str);
-unsigned int fnv_hash(std::string str);
-unsigned int jsw_hash(std::string str);
-unsigned int oat_hash(std::string str);
+    /**
+     * Maps hash onto [0, n) with a multiply instead of a modulo.
+     */
+    inline size_t reduce(uint64_t hash, size_t n){
+        return (static_cast<__uint128_t>(hash) * n) >> 64;
+    }
 
-template <int size>
+    /**
+     * True if all k bits that hash probes in the bit array are set.
+     */
+    inline bool test(const uint64_t* words, size_t bits, int k, Hash128 hash){
+        // An odd step visits k distinct values of h1 + i * h2 for any k
+        uint64_t step = hash.high | 1;
+        for (int i = 0; i < k; i++, hash.low += step){
+            size_t bit = reduce(hash.low, bits);
+            if (!(words[bit / 64] & (uint64_t(1) << (bit % 64)))){
+                return false;
+            }
+        }
+        return true;
+    }
+
+    /*
+     * Bloom files: a header, then the bit array starting on the next cache
+     * line. The header records everything a reader needs to probe the same
+     * bits as the writer. Any change to the hash function or the probe
+     * sequence must bump VERSION.
+     */
+    const uint64_t MAGIC = 0x544c464d4f4f4c42ull; // "BLOOMFLT", little-endian
+    const uint32_t VERSION = 1;
+
+    struct FileHeader {
+        uint64_t magic;
+        uint32_t version;
+        uint32_t hashes;
+        uint64_t bits;
+        uint64_t bitsSet;
+        uint64_t seed;
+        uint64_t dataOffset;
+        uint64_t fileSize;
+    };
+
+    /**
+     * Returns what is wrong with a header read from a file of the given
+     * length, or nullptr if it describes a well-formed filter.
+     */
+    inline const char* check(const FileHeader& header, uint64_t length){
+        if (header.magic != MAGIC){
+            return "not a Bloom filter";
+        } else if (header.version != VERSION){
+            return "unsupported Bloom filter version";
+        } else if (header.fileSize != length || header.bits == 0 || header.bits % 512 || header.hashes == 0 ||
+                header.dataOffset < sizeof(FileHeader) || header.dataOffset % 64 ||
+                header.bits / 8 > length - std::min(length, header.dataOffset) || header.bitsSet > header.bits){
+            return "truncated or corrupt";
+        }
+        return nullptr;
+    }
+}
+
+/**
+ * Bloom filter sized at runtime from the number of items it is expected to
+ * hold and the false positive rate wanted at that load. The bit array is
+ * allocated on the heap, on a cache line boundary, so filters can range
+ * from a few bytes to tens of gigabytes.
+ *
+ * Each key is hashed once, to 128 bits. The k bits probed are the double
+ * hashing sequence h1 + i * h2 over the two halves (Kirsch and
+ * Mitzenmacher), which keeps the false positive rate of k independent
+ * hash functions.
+ */
 class Bloom {
 public:
-    Bloom(std::vector<HashFunc_t>);
-    void add(std::string);
-    bool contains(std::string);
+    Bloom(size_t expected_items, double fpp, uint64_t seed = hash_seed());
+    ~Bloom();
+
+    Bloom(const Bloom& other);
+    Bloom& operator=(const Bloom& other);
+    Bloom(Bloom&& other) noexcept;
+    Bloom& operator=(Bloom&& other) noexcept;
+
+    void add(const void* data, size_t len){
+        add_hash(hash_bytes128(data, len, seed_));
+    }
+    bool contains(const void* data, size_t len) const {
+        return contains_hash(hash_bytes128(data, len, seed_));
+    }
+#if __cplusplus >= 201703L
+    void add(std::string_view key){
+        add(key.data(), key.size());
+    }
+    bool contains(std::string_view key) const {
+        return contains(key.data(), key.size());
+    }
+#else
+    void add(const std::string& key){
+        add(key.data(), key.size());
+    }
+    bool contains(const std::string& key) const {
+        return contains(key.data(), key.size());
+    }
+#endif
+
+    // For keys that have already been hashed
+    void add_hash(Hash128 hash);
+    bool contains_hash(Hash128 hash) const {
+        return bloom_detail::test(words_, bits_, k_, hash);
+    }
     void clear();
+
+    void merge(const Bloom& other);
+    void intersect(const Bloom& other);
+
+    void save(const std::string& path) const;
+    static Bloom load(const std::string& path);
+
+    size_t bits() const {
+        return bits_;
+    }
+    // The number of bits set per key
+    int hashes() const {
+        return k_;
+    }
+    uint64_t seed() const {
+        return seed_;
+    }
+
+    /**
+     * The fraction of bits that are set.
+     */
+    double fill_ratio() const {
+        return static_cast<double>(bitsSet_) / bits_;
+    }
+    /**
+     * The false positive rate at the current fill: the chance that all k
+     * bits probed for a key that was never added are set.
+     */
+    double fpp() const {
+        return std::pow(fill_ratio(), k_);
+    }
 private:
-    int size_ = size;
-    std::bitset<size> bits_;
-    std::vector<HashFunc_t> hashes_;
+    uint64_t* words_;
+    size_t bits_;
+    size_t bitsSet_;
+    int k_;
+    uint64_t seed_;
+
+    explicit Bloom(const bloom_detail::FileHeader& header);
+
+    void check_compatible(const Bloom& other) const;
+
+    size_t index(uint64_t hash) const {
+        return bloom_detail::reduce(hash, bits_);
+    }
 };
 
-template <int size>
-Bloom<size>::Bloom(std::vector<HashFunc_t> hashes) : hashes_(hashes) {}
+/**
+ * Creates a filter with the optimal number of bits and hash functions for
+ * holding expected_items at a false positive rate of fpp, with the bits
+ * rounded up to a whole number of cache lines.
+ */
+inline Bloom::Bloom(size_t expected_items, double fpp, uint64_t seed) : bitsSet_(0), seed_(seed) {
+    bloom_detail::Sizing sizing = bloom_detail::optimal_sizing(expected_items, fpp, 512);
+    bits_ = sizing.cells;
+    k_ = sizing.hashes;
+    words_ = bloom_detail::allocate_words(bits_ / 64);
+    clear();
+}
+
+/**
+ * Creates an empty filter of the shape described by a file header.
+ */
+inline Bloom::Bloom(const bloom_detail::FileHeader& header) :
+    words_(bloom_detail::allocate_words(header.bits / 64)),
+    bits_(header.bits),
+    bitsSet_(0),
+    k_(header.hashes),
+    seed_(header.seed)
+{
+    clear();
+}
 
-template <int size>
-void Bloom<size>::add(std::string str){
-    for (auto f : hashes_){
-        bits_[ f(str) % size_ ] = true;
+inline Bloom::~Bloom(){
+    free(words_);
+}
+
+inline Bloom::Bloom(const Bloom& other) :
+    words_(bloom_detail::allocate_words(other.bits_ / 64)),
+    bits_(other.bits_),
+    bitsSet_(other.bitsSet_),
+    k_(other.k_),
+    seed_(other.seed_)
+{
+    memcpy(words_, other.words_, bits_ / 8);
+}
+
+inline Bloom& Bloom::operator=(const Bloom& other){
+    if (this != &other){
+        uint64_t* words = bloom_detail::allocate_words(other.bits_ / 64);
+        memcpy(words, other.words_, other.bits_ / 8);
+        free(words_);
+        words_ = words;
+        bits_ = other.bits_;
+        bitsSet_ = other.bitsSet_;
+        k_ = other.k_;
+        seed_ = other.seed_;
     }
-    return;
+    return *this;
 }
 
-template <int size>
-bool Bloom<size>::contains(std::string str){
-    for (auto f : hashes_){
-        if (!bits_[ f(str) % size_ ]){
-            return false;
-        }
+/**
+ * Takes over the bits of other, which is left without any and may only be
+ * assigned to or destroyed.
+ */
+inline Bloom::Bloom(Bloom&& other) noexcept :
+    words_(other.words_),
+    bits_(other.bits_),
+    bitsSet_(other.bitsSet_),
+    k_(other.k_),
+    seed_(other.seed_)
+{
+    other.words_ = nullptr;
+    other.bits_ = other.bitsSet_ = 0;
+}
+
+inline Bloom& Bloom::operator=(Bloom&& other) noexcept {
+    if (this != &other){
+        free(words_);
+        words_ = other.words_;
+        bits_ = other.bits_;
+        bitsSet_ = other.bitsSet_;
+        k_ = other.k_;
+        seed_ = other.seed_;
+        other.words_ = nullptr;
+        other.bits_ = other.bitsSet_ = 0;
+    }
+    return *this;
+}
+
+inline void Bloom::add_hash(Hash128 hash){
+    uint64_t step = hash.high | 1;
+    for (int i = 0; i < k_; i++, hash.low += step){
+        size_t bit = index(hash.low);
+        uint64_t mask = uint64_t(1) << (bit % 64);
+
+        // Count the bits as they are first set, for fill_ratio
+        bitsSet_ += (words_[bit / 64] & mask) == 0;
+        words_[bit / 64] |= mask;
+    }
+}
+
+inline void Bloom::clear(){
+    memset(words_, 0, bits_ / 8);
+    bitsSet_ = 0;
+}
+
+/**
+ * Throws std::invalid_argument unless other probes the same bits for every
+ * key, so that the two bit arrays can be combined.
+ */
+inline void Bloom::check_compatible(const Bloom& other) const {
+    if (other.bits_ != bits_ || other.k_ != k_ || other.seed_ != seed_){
+        throw std::invalid_argument("Bloom: filters differ in size, hashes or seed");
+    }
+}
+
+/**
+ * Adds every key of other to this filter, by ORing the bit arrays.
+ */
+inline void Bloom::merge(const Bloom& other){
+    check_compatible(other);
+    size_t set = 0;
+    for (size_t i = 0; i < bits_ / 64; i++){
+        words_[i] |= other.words_[i];
+        set += __builtin_popcountll(words_[i]);
+    }
+    bitsSet_ = set;
+}
+
+/**
+ * Keeps only the bits set in both filters. Every key added to both is
+ * still found, but the false positive rate is at least that of the larger
+ * filter, as bits set by keys of one filter can line up with the other's.
+ */
+inline void Bloom::intersect(const Bloom& other){
+    check_compatible(other);
+    size_t set = 0;
+    for (size_t i = 0; i < bits_ / 64; i++){
+        words_[i] &= other.words_[i];
+        set += __builtin_popcountll(words_[i]);
+    }
+    bitsSet_ = set;
+}
+
+/**
+ * Writes the filter to path, in the format MappedBloom maps and load
+ * reads. The file is written under a temporary name and renamed over path
+ * once complete, so readers never see a partial filter. Throws
+ * std::runtime_error if the file cannot be written.
+ */
+inline void Bloom::save(const std::string& path) const {
+    using namespace bloom_detail;
+
+    FileHeader header = {};
+    header.magic = MAGIC;
+    header.version = VERSION;
+    header.hashes = k_;
+    header.bits = bits_;
+    header.bitsSet = bitsSet_;
+    header.seed = seed_;
+    header.dataOffset = 64;
+    header.fileSize = header.dataOffset + bits_ / 8;
+
+    static const char zeros[64] = {};
+    std::string temp = path + ".tmp";
+    std::ofstream out(temp, std::ios::binary | std::ios::trunc);
+    out.write(reinterpret_cast<const char*>(&header), sizeof(FileHeader));
+    out.write(zeros, header.dataOffset - sizeof(FileHeader));
+    out.write(reinterpret_cast<const char*>(words_), bits_ / 8);
+    out.close();
+
+    if (!out || std::rename(temp.c_str(), path.c_str()) != 0){
+        std::remove(temp.c_str());
+        throw std::runtime_error("could not write Bloom filter " + path);
     }
-    return true;
 }
 
-template <int size>
-void Bloom<size>::clear(){
-    bits_.reset();
+/**
+ * Reads a filter written by save into memory, where it can be added to and
+ * combined with others. Throws std::runtime_error if the file cannot be
+ * read or is not a Bloom filter.
+ */
+inline Bloom Bloom::load(const std::string& path){
+    using namespace bloom_detail;
+
+    std::ifstream in(path, std::ios::binary | std::ios::ate);
+    if (!in){
+        throw std::runtime_error("could not open Bloom filter " + path);
+    }
+    uint64_t length = in.tellg();
+    FileHeader header = {};
+    in.seekg(0);
+    in.read(reinterpret_cast<char*>(&header), sizeof(FileHeader));
+
+    const char* problem = in ? check(header, length) : "not a Bloom filter";
+    if (problem){
+        throw std::runtime_error(path + ": " + problem);
+    }
+    Bloom bloom(header);
+    in.seekg(header.dataOffset);
+    in.read(reinterpret_cast<char*>(bloom.words_), header.bits / 8);
+    if (!in){
+        throw std::runtime_error("could not read Bloom filter " + path);
+    }
+    bloom.bitsSet_ = header.bitsSet;
+    return bloom;
 }
 
 #endif // BLOOM_H
@@ -0,0 +1,552 @@
+#define BOOST_TEST_MODULE Bloom test
+#include <stdint.h>
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include <boost/test/unit_test.hpp>
+
+#include "BlockedBloom.h"
+#include "Bloom.h"
+#include "ConcurrentBloom.h"
+#include "CountingBloom.h"
+#include "CuckooFilter.h"
+#include "MappedBloom.h"
+#include "ScalableBloom.h"
+
+BOOST_AUTO_TEST_CASE(bloom_test){
+    Bloom bloom(1000, 0.01);
+    // 9585 bits and 7 hashes, with the bits rounded up to cache lines
+    BOOST_CHECK_EQUAL(bloom.bits(), 9728);
+    BOOST_CHECK_EQUAL(bloom.hashes(), 7);
+    BOOST_CHECK_EQUAL(bloom.fill_ratio(), 0);
+
+    bloom.add("Dog");
+    bloom.add(std::string("Cat"));
+    BOOST_CHECK(bloom.contains("Dog"));
+    BOOST_CHECK(bloom.contains("Cat"));
+    BOOST_CHECK(!bloom.contains("Bird"));
+
+    // Adding a key twice sets no new bits
+    double fill = bloom.fill_ratio();
+    BOOST_CHECK_GT(fill, 0);
+    bloom.add("Dog");
+    BOOST_CHECK_EQUAL(bloom.fill_ratio(), fill);
+
+    Bloom copy(bloom);
+    bloom.clear();
+    BOOST_CHECK(!bloom.contains("Dog"));
+    BOOST_CHECK_EQUAL(bloom.fill_ratio(), 0);
+    BOOST_CHECK(copy.contains("Dog"));
+
+    // Moves hand over the bits without copying them
+    static_assert(std::is_nothrow_move_constructible<Bloom>::value, "Bloom moves must not throw");
+    static_assert(std::is_nothrow_move_assignable<Bloom>::value, "Bloom moves must not throw");
+    Bloom moved(std::move(copy));
+    BOOST_CHECK(moved.contains("Dog"));
+    BOOST_CHECK_EQUAL(moved.fill_ratio(), fill);
+    bloom = std::move(moved);
+    BOOST_CHECK(bloom.contains("Cat"));
+    BOOST_CHECK_EQUAL(bloom.bits(), 9728);
+
+    BOOST_CHECK_THROW(Bloom(1000, 0), std::invalid_argument);
+    BOOST_CHECK_THROW(Bloom(1000, 1.5), std::invalid_argument);
+}
+
+BOOST_AUTO_TEST_CASE(bloom_fpp_test){
+    const uint64_t TEST_SIZE = 100000;
+    const double FPP = 0.01;
+    Bloom bloom(TEST_SIZE, FPP);
+    for (uint64_t i = 0; i < TEST_SIZE; i++){
+        bloom.add(&i, sizeof(i));
+    }
+    for (uint64_t i = 0; i < TEST_SIZE; i++){
+        BOOST_REQUIRE(bloom.contains(&i, sizeof(i)));
+    }
+
+    // Each bit is still clear with probability e^(-kn/m), about a half
+    double fill = 1 - std::exp(-static_cast<double>(bloom.hashes()) * TEST_SIZE / bloom.bits());
+    BOOST_CHECK_CLOSE(bloom.fill_ratio(), fill, 1);
+    BOOST_CHECK_CLOSE(bloom.fpp(), FPP, 10);
+
+    int positives = 0;
+    for (uint64_t i = TEST_SIZE; i < 11 * TEST_SIZE; i++){
+        positives += bloom.contains(&i, sizeof(i));
+    }
+    double fpp = positives / (10.0 * TEST_SIZE);
+    BOOST_CHECK_CLOSE(fpp, bloom.fpp(), 10);
+}
+
+BOOST_AUTO_TEST_CASE(blocked_test){
+    BlockedBloom bloom(10000);
+    BOOST_CHECK_EQUAL(bloom.bits(), 10240);
+
+    bloom.add("Dog");
+    bloom.add(std::string("Cat"));
+    BOOST_CHECK(bloom.contains("Dog"));
+    BOOST_CHECK(bloom.contains("Cat"));
+    BOOST_CHECK(!bloom.contains("Bird"));
+
+    BlockedBloom copy(bloom);
+    bloom.clear();
+    BOOST_CHECK(!bloom.contains("Dog"));
+    BOOST_CHECK(copy.contains("Dog"));
+
+    static_assert(std::is_nothrow_move_constructible<BlockedBloom>::value, "BlockedBloom moves must not throw");
+    static_assert(std::is_nothrow_move_assignable<BlockedBloom>::value, "BlockedBloom moves must not throw");
+    BlockedBloom moved(std::move(copy));
+    BOOST_CHECK(moved.contains("Cat"));
+    bloom = std::move(moved);
+    BOOST_CHECK(bloom.contains("Dog"));
+    BOOST_CHECK_EQUAL(bloom.bits(), 10240);
+}
+
+BOOST_AUTO_TEST_CASE(blocked_fpp_test){
+    // 10 bits per key
+    const uint64_t TEST_SIZE = 100000;
+    BlockedBloom bloom(10 * TEST_SIZE);
+    for (uint64_t i = 0; i < TEST_SIZE; i++){
+        bloom.add(&i, sizeof(i));
+    }
+    for (uint64_t i = 0; i < TEST_SIZE; i++){
+        BOOST_REQUIRE(bloom.contains(&i, sizeof(i)));
+    }
+
+    int positives = 0;
+    for (uint64_t i = TEST_SIZE; i < 11 * TEST_SIZE; i++){
+        positives += bloom.contains(&i, sizeof(i));
+    }
+    double fpp = positives / (10.0 * TEST_SIZE);
+    BOOST_CHECK_LT(fpp, 0.02);
+}
+
+BOOST_AUTO_TEST_CASE(counting_test){
+    CountingBloom bloom(1000, 0.01);
+    BOOST_CHECK_EQUAL(bloom.counters(), 9600);
+    BOOST_CHECK_EQUAL(bloom.hashes(), 7);
+
+    bloom.add("Dog");
+    bloom.add("Cat");
+    bloom.add("Cat");
+    BOOST_CHECK(bloom.contains("Dog"));
+    BOOST_CHECK(bloom.contains("Cat"));
+    BOOST_CHECK(!bloom.remove("Bird"));
+
+    BOOST_CHECK(bloom.remove("Dog"));
+    BOOST_CHECK(!bloom.contains("Dog"));
+    BOOST_CHECK(!bloom.remove("Dog"));
+
+    // Cat was added twice, so it stays until it is removed twice
+    BOOST_CHECK(bloom.remove("Cat"));
+    BOOST_CHECK(bloom.contains("Cat"));
+    BOOST_CHECK(bloom.remove("Cat"));
+    BOOST_CHECK(!bloom.contains("Cat"));
+    BOOST_CHECK_EQUAL(bloom.fill_ratio(), 0);
+
+    static_assert(std::is_nothrow_move_constructible<CountingBloom>::value, "CountingBloom moves must not throw");
+    static_assert(std::is_nothrow_move_assignable<CountingBloom>::value, "CountingBloom moves must not throw");
+    bloom.add("Fish");
+    CountingBloom moved(std::move(bloom));
+    BOOST_CHECK(moved.contains("Fish"));
+    bloom = std::move(moved);
+    BOOST_CHECK(bloom.remove("Fish"));
+    BOOST_CHECK_EQUAL(bloom.counters(), 9600);
+}
+
+BOOST_AUTO_TEST_CASE(counting_saturation_test){
+    CountingBloom bloom(10, 0.01);
+
+    // A saturated counter sticks, so the key can never be removed
+    for (int i = 0; i < 20; i++){
+        bloom.add("Dog");
+    }
+    for (int i = 0; i < 20; i++){
+        bloom.remove("Dog");
+    }
+    BOOST_CHECK(bloom.contains("Dog"));
+
+    // Clearing resets saturated counters too
+    CountingBloom copy(bloom);
+    copy.clear();
+    copy.add("Dog");
+    BOOST_CHECK(copy.remove("Dog"));
+    BOOST_CHECK_EQUAL(copy.fill_ratio(), 0);
+}
+
+BOOST_AUTO_TEST_CASE(counting_churn_test){
+    // A sliding window of keys, as in a cache admission filter
+    const uint64_t TEST_SIZE = 10000;
+    const uint64_t WINDOW = 1000;
+    CountingBloom bloom(WINDOW, 0.01);
+    for (uint64_t i = 0; i < TEST_SIZE; i++){
+        bloom.add(&i, sizeof(i));
+        if (i >= WINDOW){
+            uint64_t evicted = i - WINDOW;
+            BOOST_REQUIRE(bloom.remove(&evicted, sizeof(evicted)));
+        }
+    }
+    for (uint64_t i = TEST_SIZE - WINDOW; i < TEST_SIZE; i++){
+        BOOST_REQUIRE(bloom.contains(&i, sizeof(i)));
+    }
+
+    int positives = 0;
+    for (uint64_t i = 0; i < TEST_SIZE - WINDOW; i++){
+        positives += bloom.contains(&i, sizeof(i));
+    }
+    BOOST_CHECK_LT(positives / double(TEST_SIZE - WINDOW), 0.02);
+}
+
+BOOST_AUTO_TEST_CASE(concurrent_test){
+    const uint64_t THREADS = 4;
+    const uint64_t PER_THREAD = 25000;
+    ConcurrentBloom bloom(THREADS * PER_THREAD, 0.01);
+
+    std::vector<std::thread> workers;
+    for (uint64_t t = 0; t < THREADS; t++){
+        workers.emplace_back([t, &bloom]{
+            for (uint64_t i = t * PER_THREAD; i < (t + 1) * PER_THREAD; i++){
+                bloom.add(&i, sizeof(i));
+            }
+        });
+    }
+    for (auto& w : workers){
+        w.join();
+    }
+    for (uint64_t i = 0; i < THREADS * PER_THREAD; i++){
+        BOOST_REQUIRE(bloom.contains(&i, sizeof(i)));
+    }
+
+    int positives = 0;
+    for (uint64_t i = THREADS * PER_THREAD; i < 2 * THREADS * PER_THREAD; i++){
+        positives += bloom.contains(&i, sizeof(i));
+    }
+    BOOST_CHECK_LT(positives / double(THREADS * PER_THREAD), 0.02);
+    BOOST_CHECK_CLOSE(bloom.fpp(), 0.01, 10);
+}
+
+BOOST_AUTO_TEST_CASE(concurrent_merge_test){
+    const uint64_t TEST_SIZE = 10000;
+    ConcurrentBloom evens(TEST_SIZE, 0.01), odds(TEST_SIZE, 0.01);
+    for (uint64_t i = 0; i < TEST_SIZE; i++){
+        (i % 2 ? odds : evens).add(&i, sizeof(i));
+    }
+    double fill = evens.fill_ratio();
+
+    evens.merge(odds);
+    for (uint64_t i = 0; i < TEST_SIZE; i++){
+        BOOST_REQUIRE(evens.contains(&i, sizeof(i)));
+    }
+    BOOST_CHECK_GT(evens.fill_ratio(), fill);
+
+    // Merging the same bits again changes nothing
+    fill = evens.fill_ratio();
+    evens.merge(odds);
+    BOOST_CHECK_EQUAL(evens.fill_ratio(), fill);
+
+    // Other threads keep adding to both filters while they merge
+    ConcurrentBloom target(2 * TEST_SIZE, 0.01), source(2 * TEST_SIZE, 0.01);
+    for (uint64_t i = 0; i < TEST_SIZE; i++){
+        source.add(&i, sizeof(i));
+    }
+    std::vector<std::thread> workers;
+    for (ConcurrentBloom* bloom : {&target, &source}){
+        workers.emplace_back([bloom]{
+            for (uint64_t i = TEST_SIZE; i < 2 * TEST_SIZE; i++){
+                bloom->add(&i, sizeof(i));
+            }
+        });
+    }
+    for (int round = 0; round < 4; round++){
+        target.merge(source);
+    }
+    for (auto& w : workers){
+        w.join();
+    }
+    for (uint64_t i = 0; i < 2 * TEST_SIZE; i++){
+        BOOST_REQUIRE(target.contains(&i, sizeof(i)));
+    }
+
+    static_assert(std::is_nothrow_move_constructible<ConcurrentBloom>::value, "ConcurrentBloom moves must not throw");
+    static_assert(std::is_nothrow_move_assignable<ConcurrentBloom>::value, "ConcurrentBloom moves must not throw");
+    ConcurrentBloom moved(std::move(target));
+    source = std::move(moved);
+    for (uint64_t i = 0; i < 2 * TEST_SIZE; i++){
+        BOOST_REQUIRE(source.contains(&i, sizeof(i)));
+    }
+
+    ConcurrentBloom other(2 * TEST_SIZE, 0.01), reseeded(TEST_SIZE, 0.01, 1);
+    BOOST_CHECK_THROW(evens.merge(other), std::invalid_argument);
+    BOOST_CHECK_THROW(evens.merge(reseeded), std::invalid_argument);
+}
+
+BOOST_AUTO_TEST_CASE(cuckoo_test){
+    CuckooFilter<> filter(900);
+    BOOST_CHECK_EQUAL(filter.capacity(), 1024);
+    BOOST_CHECK_EQUAL(filter.bits(), 16 * 1024);
+
+    BOOST_CHECK(filter.add("Dog"));
+    BOOST_CHECK(filter.add(std::string("Cat")));
+    BOOST_CHECK(filter.contains("Dog"));
+    BOOST_CHECK(filter.contains("Cat"));
+    BOOST_CHECK(!filter.contains("Bird"));
+    BOOST_CHECK(!filter.remove("Bird"));
+
+    // Each copy of a key is removed separately
+    BOOST_CHECK(filter.add("Cat"));
+    BOOST_CHECK_EQUAL(filter.size(), 3);
+    BOOST_CHECK(filter.remove("Cat"));
+    BOOST_CHECK(filter.contains("Cat"));
+    BOOST_CHECK(filter.remove("Cat"));
+    BOOST_CHECK(!filter.contains("Cat"));
+
+    CuckooFilter<> copy(filter);
+    filter.clear();
+    BOOST_CHECK(!filter.contains("Dog"));
+    BOOST_CHECK_EQUAL(filter.size(), 0);
+    BOOST_CHECK(copy.contains("Dog"));
+
+    static_assert(std::is_nothrow_move_constructible<CuckooFilter<> >::value, "CuckooFilter moves must not throw");
+    static_assert(std::is_nothrow_move_assignable<CuckooFilter<> >::value, "CuckooFilter moves must not throw");
+    CuckooFilter<> moved(std::move(copy));
+    BOOST_CHECK(moved.contains("Dog"));
+    BOOST_CHECK_EQUAL(moved.size(), 1);
+    filter = std::move(moved);
+    BOOST_CHECK(filter.remove("Dog"));
+    BOOST_CHECK_EQUAL(filter.capacity(), 1024);
+}
+
+template <typename Fingerprint>
+void check_cuckoo_fill(double maxFpp){
+    const uint64_t TEST_SIZE = 100000;
+    CuckooFilter<Fingerprint> filter(TEST_SIZE);
+
+    // Fill until the kick-out loop gives up
+    uint64_t added = 0;
+    while (filter.add(&added, sizeof(added))){
+        added++;
+    }
+    BOOST_CHECK_GE(added, TEST_SIZE);
+    BOOST_CHECK_GT(filter.load_factor(), 0.95);
+    for (uint64_t i = 0; i <= added; i++){
+        BOOST_REQUIRE(i == added || filter.contains(&i, sizeof(i)));
+    }
+
+    int positives = 0;
+    for (uint64_t i = 1 << 30; i < (1 << 30) + TEST_SIZE; i++){
+        positives += filter.contains(&i, sizeof(i));
+    }
+    BOOST_CHECK_LT(positives / double(TEST_SIZE), maxFpp);
+
+    // Removing half the keys, the victim among them, makes room again
+    for (uint64_t i = 0; i < added; i += 2){
+        BOOST_REQUIRE(filter.remove(&i, sizeof(i)));
+    }
+    for (uint64_t i = 1; i < added; i += 2){
+        BOOST_REQUIRE(filter.contains(&i, sizeof(i)));
+    }
+    BOOST_CHECK_EQUAL(filter.size(), added - (added + 1) / 2);
+    BOOST_CHECK(filter.add(&added, sizeof(added)));
+}
+
+BOOST_AUTO_TEST_CASE(cuckoo_fill_test){
+    check_cuckoo_fill<uint8_t>(0.04);
+    check_cuckoo_fill<uint16_t>(0.001);
+}
+
+const char* PATH = "bloom_test.filter";
+
+BOOST_AUTO_TEST_CASE(seed_test){
+    const uint64_t TEST_SIZE = 1000;
+    set_hash_seed(7);
+    CountingBloom counting(TEST_SIZE, 0.01);
+    BlockedBloom blocked(8 * TEST_SIZE);
+    ConcurrentBloom concurrent(TEST_SIZE, 0.01);
+    CuckooFilter<> cuckoo(TEST_SIZE);
+    set_hash_seed(0);
+    BOOST_CHECK_EQUAL(counting.seed(), 7);
+    BOOST_CHECK_EQUAL(blocked.seed(), 7);
+    BOOST_CHECK_EQUAL(concurrent.seed(), 7);
+    BOOST_CHECK_EQUAL(cuckoo.seed(), 7);
+
+    // The same keys under another seed land on other bits
+    CountingBloom counting0(TEST_SIZE, 0.01);
+    BlockedBloom blocked0(8 * TEST_SIZE);
+    ConcurrentBloom concurrent0(TEST_SIZE, 0.01);
+    CuckooFilter<> cuckoo0(TEST_SIZE);
+    for (uint64_t i = 0; i < TEST_SIZE; i++){
+        counting.add(&i, sizeof(i));
+        blocked.add(&i, sizeof(i));
+        concurrent.add(&i, sizeof(i));
+        BOOST_REQUIRE(cuckoo.add(&i, sizeof(i)));
+        counting0.add(&i, sizeof(i));
+        blocked0.add(&i, sizeof(i));
+        concurrent0.add(&i, sizeof(i));
+        BOOST_REQUIRE(cuckoo0.add(&i, sizeof(i)));
+    }
+    int differ[4] = {0, 0, 0, 0};
+    for (uint64_t i = TEST_SIZE; i < 100 * TEST_SIZE; i++){
+        differ[0] += counting.contains(&i, sizeof(i)) != counting0.contains(&i, sizeof(i));
+        differ[1] += blocked.contains(&i, sizeof(i)) != blocked0.contains(&i, sizeof(i));
+        differ[2] += concurrent.contains(&i, sizeof(i)) != concurrent0.contains(&i, sizeof(i));
+        differ[3] += cuckoo.contains(&i, sizeof(i)) != cuckoo0.contains(&i, sizeof(i));
+    }
+    for (int d : differ){
+        BOOST_CHECK_GT(d, 0);
+    }
+
+    // Copies keep the seed, and so still find every key
+    CountingBloom countingCopy(counting);
+    BlockedBloom blockedCopy(blocked);
+    CuckooFilter<> cuckooCopy(std::move(cuckoo));
+    BOOST_CHECK_EQUAL(countingCopy.seed(), 7);
+    BOOST_CHECK_EQUAL(blockedCopy.seed(), 7);
+    BOOST_CHECK_EQUAL(cuckooCopy.seed(), 7);
+    for (uint64_t i = 0; i < TEST_SIZE; i++){
+        BOOST_REQUIRE(countingCopy.contains(&i, sizeof(i)));
+        BOOST_REQUIRE(blockedCopy.contains(&i, sizeof(i)));
+        BOOST_REQUIRE(cuckooCopy.contains(&i, sizeof(i)));
+        BOOST_REQUIRE(countingCopy.remove(&i, sizeof(i)));
+        BOOST_REQUIRE(cuckooCopy.remove(&i, sizeof(i)));
+    }
+    BOOST_CHECK_EQUAL(countingCopy.fill_ratio(), 0);
+    BOOST_CHECK_EQUAL(cuckooCopy.size(), 0);
+}
+
+BOOST_AUTO_TEST_CASE(save_test){
+    const uint64_t TEST_SIZE = 10000;
+    Bloom bloom(TEST_SIZE, 0.01, 42);
+    for (uint64_t i = 0; i < TEST_SIZE; i++){
+        bloom.add(&i, sizeof(i));
+    }
+    bloom.add("Dog");
+    bloom.save(PATH);
+
+    // The file carries the seed, whatever the reader's default
+    MappedBloom mapped(PATH);
+    Bloom loaded = Bloom::load(PATH);
+    BOOST_CHECK_EQUAL(mapped.bits(), bloom.bits());
+    BOOST_CHECK_EQUAL(mapped.hashes(), bloom.hashes());
+    BOOST_CHECK_EQUAL(mapped.seed(), 42);
+    BOOST_CHECK_EQUAL(mapped.fill_ratio(), bloom.fill_ratio());
+    BOOST_CHECK_EQUAL(loaded.fill_ratio(), bloom.fill_ratio());
+
+    for (uint64_t i = 0; i < 2 * TEST_SIZE; i++){
+        BOOST_REQUIRE_EQUAL(mapped.contains(&i, sizeof(i)), bloom.contains(&i, sizeof(i)));
+        BOOST_REQUIRE_EQUAL(loaded.contains(&i, sizeof(i)), bloom.contains(&i, sizeof(i)));
+    }
+    BOOST_CHECK(mapped.contains("Dog"));
+    BOOST_CHECK(!mapped.contains("Bird"));
+
+    // A loaded filter can be added to
+    loaded.add("Bird");
+    BOOST_CHECK(loaded.contains("Bird"));
+    std::remove(PATH);
+}
+
+BOOST_AUTO_TEST_CASE(corrupt_file_test){
+    BOOST_CHECK_THROW(MappedBloom("no/such/filter"), std::runtime_error);
+
+    {
+        std::ofstream out(PATH);
+        out << "not a filter, but long enough to hold a header";
+    }
+    BOOST_CHECK_THROW(MappedBloom mapped(PATH), std::runtime_error);
+    BOOST_CHECK_THROW(Bloom::load(PATH), std::runtime_error);
+
+    // Truncated bit array
+    Bloom(1000, 0.01).save(PATH);
+    std::string bytes;
+    {
+        std::ifstream in(PATH, std::ios::binary);
+        bytes.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+    }
+    {
+        std::ofstream out(PATH, std::ios::binary | std::ios::trunc);
+        out.write(bytes.data(), bytes.size() - 8);
+    }
+    BOOST_CHECK_THROW(MappedBloom mapped(PATH), std::runtime_error);
+    BOOST_CHECK_THROW(Bloom::load(PATH), std::runtime_error);
+    std::remove(PATH);
+}
+
+BOOST_AUTO_TEST_CASE(merge_test){
+    const uint64_t TEST_SIZE = 10000;
+    Bloom evens(TEST_SIZE, 0.01), odds(TEST_SIZE, 0.01), all(TEST_SIZE, 0.01);
+    for (uint64_t i = 0; i < TEST_SIZE; i++){
+        (i % 2 ? odds : evens).add(&i, sizeof(i));
+        all.add(&i, sizeof(i));
+    }
+
+    Bloom both(evens);
+    both.merge(odds);
+    BOOST_CHECK_EQUAL(both.fill_ratio(), all.fill_ratio());
+    for (uint64_t i = 0; i < TEST_SIZE; i++){
+        BOOST_REQUIRE(both.contains(&i, sizeof(i)));
+    }
+
+    // Only the keys added to both filters are certain to survive
+    Bloom common(all);
+    common.intersect(odds);
+    BOOST_CHECK_EQUAL(common.fill_ratio(), odds.fill_ratio());
+    for (uint64_t i = 1; i < TEST_SIZE; i += 2){
+        BOOST_REQUIRE(common.contains(&i, sizeof(i)));
+    }
+
+    BOOST_CHECK_THROW(evens.merge(Bloom(TEST_SIZE, 0.01, 1)), std::invalid_argument);
+    BOOST_CHECK_THROW(evens.intersect(Bloom(2 * TEST_SIZE, 0.01)), std::invalid_argument);
+}
+
+BOOST_AUTO_TEST_CASE(scalable_test){
+    ScalableBloom bloom(100, 0.01);
+    BOOST_CHECK_EQUAL(bloom.stages(), 1);
+    BOOST_CHECK_EQUAL(bloom.fpp(), 0);
+
+    bloom.add("Dog");
+    bloom.add(std::string("Cat"));
+    BOOST_CHECK(bloom.contains("Dog"));
+    BOOST_CHECK(bloom.contains("Cat"));
+    BOOST_CHECK(!bloom.contains("Bird"));
+
+    // Duplicates do not grow the filter
+    for (int i = 0; i < 1000; i++){
+        bloom.add("Dog");
+    }
+    BOOST_CHECK_EQUAL(bloom.stages(), 1);
+
+    bloom.clear();
+    BOOST_CHECK(!bloom.contains("Dog"));
+
+    BOOST_CHECK_THROW(ScalableBloom(100, 0.01, 0.5), std::invalid_argument);
+    BOOST_CHECK_THROW(ScalableBloom(100, 0.01, 2, 1), std::invalid_argument);
+}
+
+BOOST_AUTO_TEST_CASE(scalable_growth_test){
+    // A thousand times more keys than the first stage was sized for
+    const uint64_t INITIAL = 1000;
+    const uint64_t TEST_SIZE = 1000 * INITIAL;
+    const double FPP = 0.01;
+    ScalableBloom bloom(INITIAL, FPP);
+    for (uint64_t i = 0; i < TEST_SIZE; i++){
+        bloom.add(&i, sizeof(i));
+    }
+    for (uint64_t i = 0; i < TEST_SIZE; i++){
+        BOOST_REQUIRE(bloom.contains(&i, sizeof(i)));
+    }
+    // 1000 + 2000 + ... + 512000 holds a million keys
+    BOOST_CHECK_EQUAL(bloom.stages(), 10);
+    BOOST_CHECK_LT(bloom.fpp(), FPP);
+
+    int positives = 0;
+    for (uint64_t i = TEST_SIZE; i < 2 * TEST_SIZE; i++){
+        positives += bloom.contains(&i, sizeof(i));
+    }
+    double fpp = positives / double(TEST_SIZE);
+    BOOST_CHECK_LT(fpp, FPP);
+    BOOST_CHECK_CLOSE(fpp, bloom.fpp(), 10);
+}
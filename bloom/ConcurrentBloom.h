@@ -0,0 +1,215 @@
+/*
+ * Copyright (C) 2013 Christian Briones
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense, 
+ * and/or sell copies of the Software, and to permit persons to whom the 
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included 
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, 
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES 
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR
+ * ANY CLAIM, DAMAGES, OR OTHER LIABILITY, WHETHER IN AN ACTION OF
+ * CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+ * WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef CONCURRENT_BLOOM_H
+#define CONCURRENT_BLOOM_H
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <cmath>
+#include <stdexcept>
+#include <string>
+
+#if __cplusplus >= 201703L
+#include <string_view>
+#endif
+
+#include "Bloom.h"
+
+/**
+ * Bloom filter that any number of threads can add to and query at once,
+ * without locks. add sets each bit with an atomic fetch-or on its 64-bit
+ * word, and contains reads the words with relaxed loads, so a key is seen
+ * by other threads once they synchronize with the thread that added it.
+ *
+ * Threads only ever set bits, so no update can be lost, and inserters do
+ * not share anything but the cache lines of the bit array. Unlike Bloom,
+ * the filter does not count the bits it sets, which would put one shared
+ * counter on every add; fill_ratio counts them instead.
+ */
+class ConcurrentBloom {
+public:
+    ConcurrentBloom(size_t expected_items, double fpp, uint64_t seed = hash_seed());
+    ~ConcurrentBloom();
+
+    ConcurrentBloom(const ConcurrentBloom&) = delete;
+    ConcurrentBloom& operator=(const ConcurrentBloom&) = delete;
+    ConcurrentBloom(ConcurrentBloom&& other) noexcept;
+    ConcurrentBloom& operator=(ConcurrentBloom&& other) noexcept;
+
+    void add(const void* data, size_t len){
+        add_hash(hash_bytes128(data, len, seed_));
+    }
+    bool contains(const void* data, size_t len) const {
+        return contains_hash(hash_bytes128(data, len, seed_));
+    }
+#if __cplusplus >= 201703L
+    void add(std::string_view key){
+        add(key.data(), key.size());
+    }
+    bool contains(std::string_view key) const {
+        return contains(key.data(), key.size());
+    }
+#else
+    void add(const std::string& key){
+        add(key.data(), key.size());
+    }
+    bool contains(const std::string& key) const {
+        return contains(key.data(), key.size());
+    }
+#endif
+
+    // For keys that have already been hashed, with seed()
+    void add_hash(Hash128 hash);
+    bool contains_hash(Hash128 hash) const;
+
+    void merge(const ConcurrentBloom& other);
+
+    /**
+     * Clears the filter. Not safe while other threads are adding.
+     */
+    void clear(){
+        memset(words_, 0, bits_ / 8);
+    }
+
+    size_t bits() const {
+        return bits_;
+    }
+    int hashes() const {
+        return k_;
+    }
+    uint64_t seed() const {
+        return seed_;
+    }
+
+    double fill_ratio() const;
+    double fpp() const {
+        return std::pow(fill_ratio(), k_);
+    }
+private:
+    uint64_t* words_;
+    size_t bits_;
+    int k_;
+    uint64_t seed_;
+
+    size_t index(uint64_t hash) const {
+        return bloom_detail::reduce(hash, bits_);
+    }
+};
+
+inline ConcurrentBloom::ConcurrentBloom(size_t expected_items, double fpp, uint64_t seed) : seed_(seed) {
+    bloom_detail::Sizing sizing = bloom_detail::optimal_sizing(expected_items, fpp, 512);
+    bits_ = sizing.cells;
+    k_ = sizing.hashes;
+    words_ = bloom_detail::allocate_words(bits_ / 64);
+    clear();
+}
+
+inline ConcurrentBloom::~ConcurrentBloom(){
+    free(words_);
+}
+
+/**
+ * Takes over the bits of other, which is left without any and may only be
+ * assigned to or destroyed. Not safe while other threads use either
+ * filter.
+ */
+inline ConcurrentBloom::ConcurrentBloom(ConcurrentBloom&& other) noexcept :
+    words_(other.words_),
+    bits_(other.bits_),
+    k_(other.k_),
+    seed_(other.seed_)
+{
+    other.words_ = nullptr;
+    other.bits_ = 0;
+}
+
+inline ConcurrentBloom& ConcurrentBloom::operator=(ConcurrentBloom&& other) noexcept {
+    if (this != &other){
+        free(words_);
+        words_ = other.words_;
+        bits_ = other.bits_;
+        k_ = other.k_;
+        seed_ = other.seed_;
+        other.words_ = nullptr;
+        other.bits_ = 0;
+    }
+    return *this;
+}
+
+inline void ConcurrentBloom::add_hash(Hash128 hash){
+    uint64_t step = hash.high | 1;
+    for (int i = 0; i < k_; i++, hash.low += step){
+        size_t bit = index(hash.low);
+        uint64_t mask = uint64_t(1) << (bit % 64);
+
+        // Most bits are already set once the filter fills up, and a load is
+        // much cheaper than a locked instruction on a shared line
+        if (!(__atomic_load_n(&words_[bit / 64], __ATOMIC_RELAXED) & mask)){
+            __atomic_fetch_or(&words_[bit / 64], mask, __ATOMIC_RELAXED);
+        }
+    }
+}
+
+inline bool ConcurrentBloom::contains_hash(Hash128 hash) const {
+    uint64_t step = hash.high | 1;
+    for (int i = 0; i < k_; i++, hash.low += step){
+        size_t bit = index(hash.low);
+        if (!(__atomic_load_n(&words_[bit / 64], __ATOMIC_RELAXED) & (uint64_t(1) << (bit % 64)))){
+            return false;
+        }
+    }
+    return true;
+}
+
+/**
+ * Adds every key of other, which must have the same number of bits,
+ * hashes and seed, to this filter. Other threads may keep adding to
+ * either filter meanwhile: every word of both filters is read with a
+ * relaxed atomic load, and only the missing bits are set, atomically.
+ */
+inline void ConcurrentBloom::merge(const ConcurrentBloom& other){
+    if (other.bits_ != bits_ || other.k_ != k_ || other.seed_ != seed_){
+        throw std::invalid_argument("ConcurrentBloom: filters differ in size, hashes or seed");
+    }
+    for (size_t i = 0; i < bits_ / 64; i++){
+        uint64_t missing = __atomic_load_n(&other.words_[i], __ATOMIC_RELAXED) & ~__atomic_load_n(&words_[i], __ATOMIC_RELAXED);
+        if (missing){
+            __atomic_fetch_or(&words_[i], missing, __ATOMIC_RELAXED);
+        }
+    }
+}
+
+/**
+ * The fraction of bits that are set, counted over the whole filter.
+ */
+inline double ConcurrentBloom::fill_ratio() const {
+    size_t set = 0;
+    for (size_t i = 0; i < bits_ / 64; i++){
+        set += __builtin_popcountll(__atomic_load_n(&words_[i], __ATOMIC_RELAXED));
+    }
+    return static_cast<double>(set) / bits_;
+}
+
+#endif // CONCURRENT_BLOOM_H
@@ -0,0 +1,67 @@
+/*
+ * Ingest throughput of ConcurrentBloom against a Bloom behind one global
+ * mutex, with every thread adding its own range of keys, over a range of
+ * thread counts.
+ *
+ * Build with optimizations, e.g.
+ *     g++ -std=c++17 -O2 -pthread ConcurrentBloomBench.cpp
+ */
+#include <stdint.h>
+#include <iostream>
+#include <iomanip>
+#include <chrono>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "Bloom.h"
+#include "ConcurrentBloom.h"
+
+const uint64_t ADDS_PER_THREAD = 2000000;
+const double FPP = 0.01;
+
+/**
+ * Runs ADDS_PER_THREAD adds on each of threads threads and returns the
+ * total throughput in millions of adds per second.
+ */
+template <class Op>
+double run(int threads, Op op){
+    std::vector<std::thread> workers;
+    auto start = std::chrono::steady_clock::now();
+    for (int t = 0; t < threads; t++){
+        workers.emplace_back([t, &op]{
+            for (uint64_t key = t * ADDS_PER_THREAD; key < (t + 1) * ADDS_PER_THREAD; key++){
+                op(key);
+            }
+        });
+    }
+    for (auto& w : workers){
+        w.join();
+    }
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    return threads * ADDS_PER_THREAD / elapsed.count() / 1e6;
+}
+
+int main()
+{
+    int maxThreads = std::max(1u, std::thread::hardware_concurrency());
+
+    std::cout << "threads  mutex+Bloom (Madds/s)  ConcurrentBloom (Madds/s)" << std::endl;
+    for (int threads = 1; threads <= maxThreads; threads *= 2){
+        Bloom global(threads * ADDS_PER_THREAD, FPP);
+        std::mutex globalLock;
+        double locked = run(threads, [&](uint64_t key){
+            std::lock_guard<std::mutex> guard(globalLock);
+            global.add(&key, sizeof(key));
+        });
+
+        ConcurrentBloom shared(threads * ADDS_PER_THREAD, FPP);
+        double concurrent = run(threads, [&](uint64_t key){
+            shared.add(&key, sizeof(key));
+        });
+        std::cout << std::setw(7) << threads
+            << std::setw(23) << std::fixed << std::setprecision(1) << locked
+            << std::setw(27) << concurrent << std::endl;
+    }
+    return 0;
+}
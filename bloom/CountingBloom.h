@@ -0,0 +1,260 @@
+/*
+ * Copyright (C) 2013 Christian Briones
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense, 
+ * and/or sell copies of the Software, and to permit persons to whom the 
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included 
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, 
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES 
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR
+ * ANY CLAIM, DAMAGES, OR OTHER LIABILITY, WHETHER IN AN ACTION OF
+ * CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+ * WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef COUNTING_BLOOM_H
+#define COUNTING_BLOOM_H
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <cmath>
+#include <string>
+
+#if __cplusplus >= 201703L
+#include <string_view>
+#endif
+
+#include "Bloom.h"
+
+/**
+ * Bloom filter that supports remove, by keeping a 4-bit counter in place
+ * of each bit. Sixteen counters are packed into each 64-bit word, so the
+ * filter takes four times the memory of a Bloom with the same false
+ * positive rate.
+ *
+ * Counters saturate at 15. A saturated counter is never decremented,
+ * because it no longer knows how many keys share it, so it can only cause
+ * false positives and never a false negative. Removing a key that was
+ * never added can clear counters that other keys depend on; remove only
+ * guards against keys that are definitely absent.
+ */
+class CountingBloom {
+public:
+    CountingBloom(size_t expected_items, double fpp, uint64_t seed = hash_seed());
+    ~CountingBloom();
+
+    CountingBloom(const CountingBloom& other);
+    CountingBloom& operator=(const CountingBloom& other);
+    CountingBloom(CountingBloom&& other) noexcept;
+    CountingBloom& operator=(CountingBloom&& other) noexcept;
+
+    void add(const void* data, size_t len){
+        add_hash(hash_bytes128(data, len, seed_));
+    }
+    bool contains(const void* data, size_t len) const {
+        return contains_hash(hash_bytes128(data, len, seed_));
+    }
+    bool remove(const void* data, size_t len){
+        return remove_hash(hash_bytes128(data, len, seed_));
+    }
+#if __cplusplus >= 201703L
+    void add(std::string_view key){
+        add(key.data(), key.size());
+    }
+    bool contains(std::string_view key) const {
+        return contains(key.data(), key.size());
+    }
+    bool remove(std::string_view key){
+        return remove(key.data(), key.size());
+    }
+#else
+    void add(const std::string& key){
+        add(key.data(), key.size());
+    }
+    bool contains(const std::string& key) const {
+        return contains(key.data(), key.size());
+    }
+    bool remove(const std::string& key){
+        return remove(key.data(), key.size());
+    }
+#endif
+
+    // For keys that have already been hashed, with seed()
+    void add_hash(Hash128 hash);
+    bool contains_hash(Hash128 hash) const;
+    bool remove_hash(Hash128 hash);
+    void clear();
+
+    size_t counters() const {
+        return counters_;
+    }
+    int hashes() const {
+        return k_;
+    }
+    uint64_t seed() const {
+        return seed_;
+    }
+
+    /**
+     * The fraction of counters that are not zero.
+     */
+    double fill_ratio() const {
+        return static_cast<double>(nonzero_) / counters_;
+    }
+    /**
+     * The false positive rate at the current fill.
+     */
+    double fpp() const {
+        return std::pow(fill_ratio(), k_);
+    }
+private:
+    static const uint64_t MAX_COUNT = 15;
+
+    uint64_t* words_;
+    size_t counters_;
+    size_t nonzero_;
+    int k_;
+    uint64_t seed_;
+
+    /**
+     * Adds delta, 1 or -1, to the counter without a branch, unless it is
+     * saturated or the counter would drop below zero. Returns the
+     * counter's previous value.
+     */
+    uint64_t update(size_t counter, int delta){
+        uint64_t& word = words_[counter / 16];
+        unsigned shift = (counter % 16) * 4;
+        uint64_t count = (word >> shift) & MAX_COUNT;
+
+        // Decrements need a count in [1, 14], or they would borrow from
+        // the next counter
+        bool change = delta > 0 ? count != MAX_COUNT : count - 1 < MAX_COUNT - 1;
+        word += static_cast<uint64_t>(delta * change) << shift;
+        return count;
+    }
+    uint64_t count(size_t counter) const {
+        return (words_[counter / 16] >> ((counter % 16) * 4)) & MAX_COUNT;
+    }
+    size_t index(uint64_t hash) const {
+        return bloom_detail::reduce(hash, counters_);
+    }
+};
+
+/**
+ * Creates a filter with the optimal number of counters and hash functions
+ * for holding expected_items at a false positive rate of fpp, with the
+ * counters rounded up to a whole number of cache lines.
+ */
+inline CountingBloom::CountingBloom(size_t expected_items, double fpp, uint64_t seed) : nonzero_(0), seed_(seed) {
+    bloom_detail::Sizing sizing = bloom_detail::optimal_sizing(expected_items, fpp, 128);
+    counters_ = sizing.cells;
+    k_ = sizing.hashes;
+    words_ = bloom_detail::allocate_words(counters_ / 16);
+    clear();
+}
+
+inline CountingBloom::~CountingBloom(){
+    free(words_);
+}
+
+inline CountingBloom::CountingBloom(const CountingBloom& other) :
+    words_(bloom_detail::allocate_words(other.counters_ / 16)),
+    counters_(other.counters_),
+    nonzero_(other.nonzero_),
+    k_(other.k_),
+    seed_(other.seed_)
+{
+    memcpy(words_, other.words_, counters_ / 2);
+}
+
+inline CountingBloom& CountingBloom::operator=(const CountingBloom& other){
+    if (this != &other){
+        uint64_t* words = bloom_detail::allocate_words(other.counters_ / 16);
+        memcpy(words, other.words_, other.counters_ / 2);
+        free(words_);
+        words_ = words;
+        counters_ = other.counters_;
+        nonzero_ = other.nonzero_;
+        k_ = other.k_;
+        seed_ = other.seed_;
+    }
+    return *this;
+}
+
+/**
+ * Takes over the counters of other, which is left without any and may
+ * only be assigned to or destroyed.
+ */
+inline CountingBloom::CountingBloom(CountingBloom&& other) noexcept :
+    words_(other.words_),
+    counters_(other.counters_),
+    nonzero_(other.nonzero_),
+    k_(other.k_),
+    seed_(other.seed_)
+{
+    other.words_ = nullptr;
+    other.counters_ = other.nonzero_ = 0;
+}
+
+inline CountingBloom& CountingBloom::operator=(CountingBloom&& other) noexcept {
+    if (this != &other){
+        free(words_);
+        words_ = other.words_;
+        counters_ = other.counters_;
+        nonzero_ = other.nonzero_;
+        k_ = other.k_;
+        seed_ = other.seed_;
+        other.words_ = nullptr;
+        other.counters_ = other.nonzero_ = 0;
+    }
+    return *this;
+}
+
+inline void CountingBloom::add_hash(Hash128 hash){
+    uint64_t step = hash.high | 1;
+    for (int i = 0; i < k_; i++, hash.low += step){
+        nonzero_ += update(index(hash.low), 1) == 0;
+    }
+}
+
+inline bool CountingBloom::contains_hash(Hash128 hash) const {
+    uint64_t step = hash.high | 1;
+    for (int i = 0; i < k_; i++, hash.low += step){
+        if (count(index(hash.low)) == 0){
+            return false;
+        }
+    }
+    return true;
+}
+
+/**
+ * Removes a key. Returns false, and changes nothing, if the key is
+ * definitely not in the filter.
+ */
+inline bool CountingBloom::remove_hash(Hash128 hash){
+    if (!contains_hash(hash)){
+        return false;
+    }
+    uint64_t step = hash.high | 1;
+    for (int i = 0; i < k_; i++, hash.low += step){
+        nonzero_ -= update(index(hash.low), -1) == 1;
+    }
+    return true;
+}
+
+inline void CountingBloom::clear(){
+    memset(words_, 0, counters_ / 2);
+    nonzero_ = 0;
+}
+
+#endif // COUNTING_BLOOM_H
@@ -0,0 +1,399 @@
+/*
+ * Copyright (C) 2013 Christian Briones
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense, 
+ * and/or sell copies of the Software, and to permit persons to whom the 
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included 
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, 
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES 
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR
+ * ANY CLAIM, DAMAGES, OR OTHER LIABILITY, WHETHER IN AN ACTION OF
+ * CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+ * WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef CUCKOO_FILTER_H
+#define CUCKOO_FILTER_H
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <string>
+#include <type_traits>
+
+#if __cplusplus >= 201703L
+#include <string_view>
+#endif
+
+#include "Bloom.h"
+
+namespace cuckoo_detail {
+    /**
+     * A bucket of four fingerprints, read as one integer so that all four
+     * slots are compared at once.
+     */
+    template <typename Fingerprint>
+    struct Lanes;
+
+    template <>
+    struct Lanes<uint8_t> {
+        typedef uint32_t Word;
+        static const Word LOW = 0x7f7f7f7fu;
+        static const Word ONES = 0x01010101u;
+        static const int WIDTH = 8;
+    };
+
+    template <>
+    struct Lanes<uint16_t> {
+        typedef uint64_t Word;
+        static const Word LOW = 0x7fff7fff7fff7fffull;
+        static const Word ONES = 0x0001000100010001ull;
+        static const int WIDTH = 16;
+    };
+}
+
+/**
+ * Cuckoo filter (Fan et al.): an approximate set like Bloom, that also
+ * supports remove, and takes less space than a Bloom filter for false
+ * positive rates below about 3%.
+ *
+ * Each key is stored as an 8 or 16-bit fingerprint in one of two buckets
+ * of four slots. The second bucket is the first XORed with a hash of the
+ * fingerprint, so either can be found from the other without the key.
+ * When both are full, a random resident is kicked to its other bucket,
+ * for at most MAX_KICKS moves. If that fails, the last fingerprint moved
+ * is kept aside and the filter reports itself full, so no key is lost.
+ *
+ * The false positive rate is about 8 / 2^bits at full load: 3% for 8-bit
+ * fingerprints, 0.01% for 16-bit. A key added n times must be removed n
+ * times, and at most eight copies of a key fit.
+ */
+template <typename Fingerprint = uint16_t>
+class CuckooFilter {
+    static_assert(std::is_same<Fingerprint, uint8_t>::value || std::is_same<Fingerprint, uint16_t>::value,
+            "CuckooFilter fingerprints are 8 or 16 bits");
+public:
+    explicit CuckooFilter(size_t expected_items, uint64_t seed = hash_seed());
+    ~CuckooFilter();
+
+    CuckooFilter(const CuckooFilter& other);
+    CuckooFilter& operator=(const CuckooFilter& other);
+    CuckooFilter(CuckooFilter&& other) noexcept;
+    CuckooFilter& operator=(CuckooFilter&& other) noexcept;
+
+    bool add(const void* data, size_t len){
+        return add_hash(hash_bytes128(data, len, seed_));
+    }
+    bool contains(const void* data, size_t len) const {
+        return contains_hash(hash_bytes128(data, len, seed_));
+    }
+    bool remove(const void* data, size_t len){
+        return remove_hash(hash_bytes128(data, len, seed_));
+    }
+#if __cplusplus >= 201703L
+    bool add(std::string_view key){
+        return add(key.data(), key.size());
+    }
+    bool contains(std::string_view key) const {
+        return contains(key.data(), key.size());
+    }
+    bool remove(std::string_view key){
+        return remove(key.data(), key.size());
+    }
+#else
+    bool add(const std::string& key){
+        return add(key.data(), key.size());
+    }
+    bool contains(const std::string& key) const {
+        return contains(key.data(), key.size());
+    }
+    bool remove(const std::string& key){
+        return remove(key.data(), key.size());
+    }
+#endif
+
+    // For keys that have already been hashed, with seed()
+    bool add_hash(Hash128 hash);
+    bool contains_hash(Hash128 hash) const;
+    bool remove_hash(Hash128 hash);
+    void clear();
+
+    size_t size() const {
+        return size_;
+    }
+    size_t capacity() const {
+        return (mask_ + 1) * SLOTS;
+    }
+    double load_factor() const {
+        return static_cast<double>(size_) / capacity();
+    }
+    size_t bits() const {
+        return capacity() * sizeof(Fingerprint) * 8;
+    }
+    uint64_t seed() const {
+        return seed_;
+    }
+private:
+    typedef cuckoo_detail::Lanes<Fingerprint> Lanes;
+    typedef typename Lanes::Word Word;
+
+    static const int SLOTS = 4;
+    static const int MAX_KICKS = 500;
+
+    // A fingerprint of zero marks an empty slot
+    Fingerprint* slots_;
+    size_t mask_;
+    size_t size_;
+
+    // The fingerprint left over when a kick-out sequence failed
+    bool hasVictim_;
+    Fingerprint victim_;
+    size_t victimBucket_;
+
+    uint64_t random_;
+    uint64_t seed_;
+
+    static Fingerprint fingerprint(uint64_t hash){
+        // Never zero
+        return static_cast<Fingerprint>(hash % ((uint64_t(1) << Lanes::WIDTH) - 1) + 1);
+    }
+    size_t alternate(size_t bucket, Fingerprint fp) const {
+        return (bucket ^ hash_int(fp, seed_)) & mask_;
+    }
+    Word load(size_t bucket) const {
+        Word word;
+        memcpy(&word, slots_ + bucket * SLOTS, sizeof(word));
+        return word;
+    }
+
+    /**
+     * One bit, the top of the lane, for each slot of the bucket that holds
+     * fp. Lanes are compared exactly, without the borrow between lanes of
+     * the usual has-zero trick.
+     */
+    Word match(size_t bucket, Fingerprint fp) const {
+        Word x = load(bucket) ^ (Lanes::ONES * fp);
+        return ~(((x & Lanes::LOW) + Lanes::LOW) | x | Lanes::LOW);
+    }
+    static int first(Word matches){
+        return __builtin_ctzll(matches) / Lanes::WIDTH;
+    }
+
+    bool put(size_t bucket, Fingerprint fp){
+        Word empty = match(bucket, 0);
+        if (!empty){
+            return false;
+        }
+        slots_[bucket * SLOTS + first(empty)] = fp;
+        return true;
+    }
+    void place(size_t bucket, Fingerprint fp);
+
+    bool erase(size_t bucket, Fingerprint fp){
+        Word matches = match(bucket, fp);
+        if (!matches){
+            return false;
+        }
+        slots_[bucket * SLOTS + first(matches)] = 0;
+        return true;
+    }
+};
+
+/**
+ * Creates a filter with room for at least expected_items keys at a load of
+ * 95%, which the kick-out loop reliably reaches with four-slot buckets.
+ * The bucket count is a power of two.
+ */
+template <typename Fingerprint>
+CuckooFilter<Fingerprint>::CuckooFilter(size_t expected_items, uint64_t seed) :
+    size_(0),
+    hasVictim_(false),
+    victim_(0),
+    victimBucket_(0),
+    random_(0x9e3779b97f4a7c15ull),
+    seed_(seed)
+{
+    size_t buckets = 64 / (SLOTS * sizeof(Fingerprint));
+    while (buckets * SLOTS * 0.95 < expected_items){
+        buckets *= 2;
+    }
+    mask_ = buckets - 1;
+    slots_ = reinterpret_cast<Fingerprint*>(bloom_detail::allocate_words(bits() / 64));
+    clear();
+}
+
+template <typename Fingerprint>
+CuckooFilter<Fingerprint>::~CuckooFilter(){
+    free(slots_);
+}
+
+template <typename Fingerprint>
+CuckooFilter<Fingerprint>::CuckooFilter(const CuckooFilter& other) :
+    slots_(reinterpret_cast<Fingerprint*>(bloom_detail::allocate_words(other.bits() / 64))),
+    mask_(other.mask_),
+    size_(other.size_),
+    hasVictim_(other.hasVictim_),
+    victim_(other.victim_),
+    victimBucket_(other.victimBucket_),
+    random_(other.random_),
+    seed_(other.seed_)
+{
+    memcpy(slots_, other.slots_, bits() / 8);
+}
+
+template <typename Fingerprint>
+CuckooFilter<Fingerprint>& CuckooFilter<Fingerprint>::operator=(const CuckooFilter& other){
+    if (this != &other){
+        Fingerprint* slots = reinterpret_cast<Fingerprint*>(bloom_detail::allocate_words(other.bits() / 64));
+        memcpy(slots, other.slots_, other.bits() / 8);
+        free(slots_);
+        slots_ = slots;
+        mask_ = other.mask_;
+        size_ = other.size_;
+        hasVictim_ = other.hasVictim_;
+        victim_ = other.victim_;
+        victimBucket_ = other.victimBucket_;
+        random_ = other.random_;
+        seed_ = other.seed_;
+    }
+    return *this;
+}
+
+/**
+ * Takes over the buckets of other, which is left without any and may only
+ * be assigned to or destroyed.
+ */
+template <typename Fingerprint>
+CuckooFilter<Fingerprint>::CuckooFilter(CuckooFilter&& other) noexcept :
+    slots_(other.slots_),
+    mask_(other.mask_),
+    size_(other.size_),
+    hasVictim_(other.hasVictim_),
+    victim_(other.victim_),
+    victimBucket_(other.victimBucket_),
+    random_(other.random_),
+    seed_(other.seed_)
+{
+    other.slots_ = nullptr;
+    other.mask_ = other.size_ = 0;
+    other.hasVictim_ = false;
+}
+
+template <typename Fingerprint>
+CuckooFilter<Fingerprint>& CuckooFilter<Fingerprint>::operator=(CuckooFilter&& other) noexcept {
+    if (this != &other){
+        free(slots_);
+        slots_ = other.slots_;
+        mask_ = other.mask_;
+        size_ = other.size_;
+        hasVictim_ = other.hasVictim_;
+        victim_ = other.victim_;
+        victimBucket_ = other.victimBucket_;
+        random_ = other.random_;
+        seed_ = other.seed_;
+        other.slots_ = nullptr;
+        other.mask_ = other.size_ = 0;
+        other.hasVictim_ = false;
+    }
+    return *this;
+}
+
+/**
+ * Adds a key. Returns false if the filter is full, in which case the key
+ * has not been added.
+ */
+template <typename Fingerprint>
+bool CuckooFilter<Fingerprint>::add_hash(Hash128 hash){
+    if (hasVictim_){
+        return false;
+    }
+    place(hash.low & mask_, fingerprint(hash.high));
+    size_++;
+    return true;
+}
+
+/**
+ * Stores fp in bucket or its alternate, kicking residents out to their
+ * other buckets to make room. If that goes on for too long, the last
+ * fingerprint kicked out becomes the victim.
+ */
+template <typename Fingerprint>
+void CuckooFilter<Fingerprint>::place(size_t bucket, Fingerprint fp){
+    if (put(bucket, fp)){
+        return;
+    }
+    bucket = alternate(bucket, fp);
+    for (int kicks = 0; kicks < MAX_KICKS; kicks++){
+        if (put(bucket, fp)){
+            return;
+        }
+        // Swap with a random resident, and move it to its other bucket
+        random_ ^= random_ << 13;
+        random_ ^= random_ >> 7;
+        random_ ^= random_ << 17;
+        Fingerprint& slot = slots_[bucket * SLOTS + random_ % SLOTS];
+        Fingerprint evicted = slot;
+        slot = fp;
+        fp = evicted;
+        bucket = alternate(bucket, fp);
+    }
+    hasVictim_ = true;
+    victim_ = fp;
+    victimBucket_ = bucket;
+}
+
+template <typename Fingerprint>
+bool CuckooFilter<Fingerprint>::contains_hash(Hash128 hash) const {
+    Fingerprint fp = fingerprint(hash.high);
+    size_t bucket = hash.low & mask_;
+    size_t other = alternate(bucket, fp);
+    if (match(bucket, fp) | match(other, fp)){
+        return true;
+    }
+    return hasVictim_ && victim_ == fp && (victimBucket_ == bucket || victimBucket_ == other);
+}
+
+/**
+ * Removes a key. Returns false if the key is definitely not in the filter.
+ * Removing a key that was never added can remove another key that shares
+ * its fingerprint and buckets.
+ */
+template <typename Fingerprint>
+bool CuckooFilter<Fingerprint>::remove_hash(Hash128 hash){
+    Fingerprint fp = fingerprint(hash.high);
+    size_t bucket = hash.low & mask_;
+    size_t other = alternate(bucket, fp);
+    if (erase(bucket, fp) || erase(other, fp)){
+        size_--;
+        if (hasVictim_){
+            // There is room again for the fingerprint kept aside
+            hasVictim_ = false;
+            place(victimBucket_, victim_);
+        }
+        return true;
+    }
+    if (hasVictim_ && victim_ == fp && (victimBucket_ == bucket || victimBucket_ == other)){
+        hasVictim_ = false;
+        size_--;
+        return true;
+    }
+    return false;
+}
+
+template <typename Fingerprint>
+void CuckooFilter<Fingerprint>::clear(){
+    memset(slots_, 0, bits() / 8);
+    size_ = 0;
+    hasVictim_ = false;
+}
+
+#endif // CUCKOO_FILTER_H
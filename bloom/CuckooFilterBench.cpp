@@ -0,0 +1,92 @@
+/*
+ * Space and query throughput of CuckooFilter against Bloom at the same
+ * false positive rate, for 8 and 16-bit fingerprints. Each filter is
+ * filled to capacity with string keys, and queried with a mix of present
+ * and absent keys.
+ *
+ * Build with optimizations, e.g.
+ *     g++ -std=c++17 -O2 CuckooFilterBench.cpp
+ */
+#include <iostream>
+#include <iomanip>
+#include <chrono>
+#include <string>
+#include <vector>
+
+#include "Bloom.h"
+#include "CuckooFilter.h"
+
+const size_t KEYS = 1 << 22;
+
+struct Result {
+    double bitsPerKey;
+    double fpp;
+    double mqps;
+};
+
+/**
+ * Queries every key in queries and returns the throughput in millions of
+ * queries per second, with the fraction of absent keys reported present.
+ */
+template <class Filter>
+Result measure(const Filter& filter, size_t bits, size_t added, const std::vector<std::string>& queries){
+    size_t positives = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (auto& key : queries){
+        positives += filter.contains(key);
+    }
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+    // The first half of the queries were added
+    Result result;
+    result.bitsPerKey = static_cast<double>(bits) / added;
+    result.fpp = static_cast<double>(positives - queries.size() / 2) / (queries.size() / 2);
+    result.mqps = queries.size() / elapsed.count() / 1e6;
+    return result;
+}
+
+void print(const char* name, const Result& r){
+    std::cout << std::setw(18) << name
+        << std::setw(10) << std::fixed << std::setprecision(1) << r.bitsPerKey
+        << std::setw(11) << std::setprecision(4) << 100 * r.fpp
+        << std::setw(10) << std::setprecision(1) << r.mqps << std::endl;
+}
+
+template <typename Fingerprint>
+void compare(const char* name, const std::vector<std::string>& keys){
+    CuckooFilter<Fingerprint> cuckoo(KEYS);
+    size_t added = 0;
+    while (added < keys.size() && cuckoo.add(keys[added])){
+        added++;
+    }
+
+    std::vector<std::string> queries(keys.begin(), keys.begin() + added);
+    for (size_t i = 0; i < added; i++){
+        queries.push_back("absent:" + std::to_string(i));
+    }
+    Result c = measure(cuckoo, cuckoo.bits(), added, queries);
+
+    // A Bloom filter holding the same keys at the same false positive rate
+    Bloom bloom(added, c.fpp);
+    for (size_t i = 0; i < added; i++){
+        bloom.add(keys[i]);
+    }
+    Result b = measure(bloom, bloom.bits(), added, queries);
+
+    std::cout << name << " fingerprints, " << added << " keys" << std::endl;
+    print("CuckooFilter", c);
+    print("Bloom", b);
+}
+
+int main()
+{
+    std::vector<std::string> keys;
+    for (size_t i = 0; i < 2 * KEYS; i++){
+        keys.push_back("user:" + std::to_string(i));
+    }
+
+    std::cout << std::setw(18) << "" << "  bits/key      fpp%     Mq/s" << std::endl;
+    compare<uint8_t>("8-bit", keys);
+    compare<uint16_t>("16-bit", keys);
+    return 0;
+}
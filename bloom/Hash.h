@@ -1,4 +0,0 @@
-unsigned int sax_hash(std::string str);
-unsigned int fnv_hash(std::string str);
-unsigned int jsw_hash(std::string str);
-unsigned int oat_hash(std::string str);
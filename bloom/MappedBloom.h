@@ -0,0 +1,139 @@
+/*
+ * Copyright (C) 2013 Christian Briones
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense, 
+ * and/or sell copies of the Software, and to permit persons to whom the 
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included 
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, 
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES 
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR
+ * ANY CLAIM, DAMAGES, OR OTHER LIABILITY, WHETHER IN AN ACTION OF
+ * CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+ * WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef MAPPED_BLOOM_H
+#define MAPPED_BLOOM_H
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdint.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cmath>
+#include <stdexcept>
+#include <string>
+
+#if __cplusplus >= 201703L
+#include <string_view>
+#endif
+
+#include "Bloom.h"
+
+/**
+ * Read-only Bloom filter queried straight from a memory-mapped file
+ * written by Bloom::save. Opening a filter only maps and checks its
+ * header, however large the bit array; pages are faulted in by the
+ * queries that touch them, and are shared through the page cache with
+ * every other process mapping the same file.
+ */
+class MappedBloom {
+public:
+    explicit MappedBloom(const std::string& path);
+    ~MappedBloom();
+
+    MappedBloom(const MappedBloom&) = delete;
+    MappedBloom& operator=(const MappedBloom&) = delete;
+
+    bool contains(const void* data, size_t len) const {
+        return contains_hash(hash_bytes128(data, len, header_->seed));
+    }
+#if __cplusplus >= 201703L
+    bool contains(std::string_view key) const {
+        return contains(key.data(), key.size());
+    }
+#else
+    bool contains(const std::string& key) const {
+        return contains(key.data(), key.size());
+    }
+#endif
+    bool contains_hash(Hash128 hash) const {
+        return bloom_detail::test(words_, header_->bits, header_->hashes, hash);
+    }
+
+    size_t bits() const {
+        return header_->bits;
+    }
+    int hashes() const {
+        return header_->hashes;
+    }
+    uint64_t seed() const {
+        return header_->seed;
+    }
+    double fill_ratio() const {
+        return static_cast<double>(header_->bitsSet) / header_->bits;
+    }
+    double fpp() const {
+        return std::pow(fill_ratio(), hashes());
+    }
+private:
+    const char* data_ = nullptr;
+    size_t length_ = 0;
+    const bloom_detail::FileHeader* header_;
+    const uint64_t* words_;
+};
+
+/**
+ * Maps the filter at path. Throws std::runtime_error if it cannot be
+ * mapped or is not a Bloom filter.
+ */
+inline MappedBloom::MappedBloom(const std::string& path){
+    using namespace bloom_detail;
+
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0){
+        throw std::runtime_error("could not open Bloom filter " + path + ": " + strerror(errno));
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || static_cast<size_t>(st.st_size) < sizeof(FileHeader)){
+        close(fd);
+        throw std::runtime_error(path + ": not a Bloom filter");
+    }
+    length_ = st.st_size;
+    void* data = mmap(nullptr, length_, PROT_READ, MAP_SHARED, fd, 0);
+    int error = errno;
+    close(fd);
+    if (data == MAP_FAILED){
+        throw std::runtime_error("could not map Bloom filter " + path + ": " + strerror(error));
+    }
+    data_ = static_cast<const char*>(data);
+
+    header_ = reinterpret_cast<const FileHeader*>(data_);
+    const char* problem = check(*header_, length_);
+    if (problem){
+        munmap(data, length_);
+        throw std::runtime_error(path + ": " + problem);
+    }
+    words_ = reinterpret_cast<const uint64_t*>(data_ + header_->dataOffset);
+
+    // Every query lands on a random page, so read-ahead would only evict
+    // pages that are still wanted
+    madvise(data, length_, MADV_RANDOM);
+}
+
+inline MappedBloom::~MappedBloom(){
+    munmap(const_cast<char*>(data_), length_);
+}
+
+#endif // MAPPED_BLOOM_H
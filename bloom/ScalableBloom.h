@@ -0,0 +1,201 @@
+/*
+ * Copyright (C) 2013 Christian Briones
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense, 
+ * and/or sell copies of the Software, and to permit persons to whom the 
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included 
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, 
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES 
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR
+ * ANY CLAIM, DAMAGES, OR OTHER LIABILITY, WHETHER IN AN ACTION OF
+ * CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+ * WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef SCALABLE_BLOOM_H
+#define SCALABLE_BLOOM_H
+
+#include <stdint.h>
+
+#include <cmath>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#if __cplusplus >= 201703L
+#include <string_view>
+#endif
+
+#include "Bloom.h"
+
+/**
+ * Bloom filter that grows with the number of keys added, while keeping
+ * its false positive rate below a fixed bound (Almeida et al.).
+ *
+ * Keys are added to the newest of a chain of Bloom stages. Once a stage
+ * holds the keys it was sized for, a new one is started, growth times as
+ * large and with its false positive rate tightened by a factor of
+ * tightening. A key is looked up in every stage, newest first, so the
+ * false positive rates of the stages add up; with stage i built for
+ *
+ *     p_i = p (1 - r) r^i
+ *
+ * they sum to less than p however many stages there are. Memory grows
+ * linearly with the number of keys, plus a log factor for the tightening.
+ */
+class ScalableBloom {
+public:
+    ScalableBloom(size_t initial_capacity, double fpp, double growth = 2, double tightening = 0.8,
+            uint64_t seed = hash_seed());
+
+    void add(const void* data, size_t len){
+        add_hash(hash_bytes128(data, len, seed_));
+    }
+    bool contains(const void* data, size_t len) const {
+        return contains_hash(hash_bytes128(data, len, seed_));
+    }
+#if __cplusplus >= 201703L
+    void add(std::string_view key){
+        add(key.data(), key.size());
+    }
+    bool contains(std::string_view key) const {
+        return contains(key.data(), key.size());
+    }
+#else
+    void add(const std::string& key){
+        add(key.data(), key.size());
+    }
+    bool contains(const std::string& key) const {
+        return contains(key.data(), key.size());
+    }
+#endif
+
+    // For keys that have already been hashed, with seed()
+    void add_hash(Hash128 hash);
+    bool contains_hash(Hash128 hash) const;
+    void clear();
+
+    size_t stages() const {
+        return stages_.size();
+    }
+    // The total number of bits over every stage
+    size_t bits() const;
+    uint64_t seed() const {
+        return seed_;
+    }
+
+    /**
+     * The false positive rate at the current fill of every stage: the
+     * chance that a key never added is found in any of them.
+     */
+    double fpp() const;
+private:
+    struct Stage {
+        std::unique_ptr<Bloom> bloom;
+        // The fill ratio at which the stage holds the keys it was sized for
+        double full;
+    };
+
+    std::vector<Stage> stages_;
+    size_t capacity_;
+    double fpp_;
+    double growth_;
+    double tightening_;
+    uint64_t seed_;
+
+    void add_stage();
+};
+
+/**
+ * Creates a filter whose first stage holds initial_capacity keys, and
+ * whose false positive rate stays below fpp. Throws std::invalid_argument
+ * unless growth is at least 1 and tightening is between 0 and 1.
+ */
+inline ScalableBloom::ScalableBloom(size_t initial_capacity, double fpp, double growth, double tightening, uint64_t seed) :
+    capacity_(initial_capacity > 0 ? initial_capacity : 1),
+    fpp_(fpp),
+    growth_(growth),
+    tightening_(tightening),
+    seed_(seed)
+{
+    if (!(growth >= 1)){
+        throw std::invalid_argument("ScalableBloom: growth must be at least 1");
+    }
+    if (!(tightening > 0 && tightening < 1)){
+        throw std::invalid_argument("ScalableBloom: tightening must be between 0 and 1");
+    }
+    add_stage();
+}
+
+/**
+ * Starts a stage for the next capacity and false positive rate in the
+ * geometric sequences.
+ */
+inline void ScalableBloom::add_stage(){
+    double n = capacity_ * std::pow(growth_, stages_.size());
+    double p = fpp_ * (1 - tightening_) * std::pow(tightening_, stages_.size());
+
+    Stage stage;
+    stage.bloom.reset(new Bloom(static_cast<size_t>(n), p, seed_));
+    stage.full = 1 - std::exp(-stage.bloom->hashes() * n / stage.bloom->bits());
+    stages_.push_back(std::move(stage));
+}
+
+/**
+ * Adds a key to the newest stage, unless some stage already reports it
+ * present, so that duplicates do not fill stages up early.
+ */
+inline void ScalableBloom::add_hash(Hash128 hash){
+    if (contains_hash(hash)){
+        return;
+    }
+    if (stages_.back().bloom->fill_ratio() >= stages_.back().full){
+        add_stage();
+    }
+    stages_.back().bloom->add_hash(hash);
+}
+
+inline bool ScalableBloom::contains_hash(Hash128 hash) const {
+    // The newest stage holds the most keys
+    for (size_t i = stages_.size(); i-- > 0;){
+        if (stages_[i].bloom->contains_hash(hash)){
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * Removes every key, and every stage but the first.
+ */
+inline void ScalableBloom::clear(){
+    stages_.resize(1);
+    stages_[0].bloom->clear();
+}
+
+inline size_t ScalableBloom::bits() const {
+    size_t bits = 0;
+    for (const Stage& stage : stages_){
+        bits += stage.bloom->bits();
+    }
+    return bits;
+}
+
+inline double ScalableBloom::fpp() const {
+    double none = 1;
+    for (const Stage& stage : stages_){
+        none *= 1 - stage.bloom->fpp();
+    }
+    return 1 - none;
+}
+
+#endif // SCALABLE_BLOOM_H
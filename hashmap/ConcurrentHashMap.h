@@ -0,0 +1,312 @@
+/*
+ * Copyright (C) 2013 Christian Briones
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense, 
+ * and/or sell copies of the Software, and to permit persons to whom the 
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included 
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, 
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES 
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR
+ * ANY CLAIM, DAMAGES, OR OTHER LIABILITY, WHETHER IN AN ACTION OF
+ * CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+ * WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef CONCURRENT_HASH_MAP_H_
+#define CONCURRENT_HASH_MAP_H_
+
+#include <atomic>
+#include <mutex>
+#include <memory>
+#include <thread>
+#include <vector>
+#include <type_traits>
+#include <stdint.h>
+
+#include "Epoch.h"
+#include "Hash.h"
+#include "HashMap.h"
+
+/**
+ * Thread-safe hash table built from independently locked HashMap shards.
+ *
+ * A key's shard is chosen from the high bits of its mixed hash, which the
+ * shard's own table does not use for indexing. Writers take the shard's
+ * mutex. Readers never lock: each shard is also a sequence lock, and a
+ * read that overlaps a write to its shard is simply retried.
+ *
+ * An insert that would rehash a shard's table in place builds a new
+ * table from the live pairs instead and publishes it, so a reader can
+ * always finish probing the table it started on. Readers hold an
+ * Epoch::Guard, and replaced tables are retired through Epoch, which
+ * deletes them once no reader can still be probing them.
+ *
+ * That deletion is lazy. A thread only tries to move the epoch on every
+ * 64 retires, and only the thread that retired a table deletes it: when
+ * it next takes a Guard or retires again, once the epoch has moved on
+ * twice. A writer that stops writing keeps the last tables it replaced
+ * alive until then, or until another thread takes over its record after
+ * it exits.
+ *
+ * Optimistic readers copy keys and values while a writer may be changing
+ * them, so both must be trivially copyable.
+ */
+template <typename Key, typename Value>
+class ConcurrentHashMap {
+    static_assert(std::is_trivially_copyable<Key>::value,
+            "ConcurrentHashMap keys must be trivially copyable");
+    static_assert(std::is_trivially_copyable<Value>::value,
+            "ConcurrentHashMap values must be trivially copyable");
+public:
+    ConcurrentHashMap(int shards = 64);
+    ~ConcurrentHashMap();
+
+    ConcurrentHashMap(const ConcurrentHashMap<Key, Value>&) = delete;
+    ConcurrentHashMap<Key, Value>& operator=(const ConcurrentHashMap<Key, Value>&) = delete;
+
+    bool get(const Key& key, Value& value) const;
+    bool contains(const Key& key) const;
+
+    bool insert_or_assign(const Key& key, const Value& value);
+    void put(const Key& key, const Value& value){
+        insert_or_assign(key, value);
+    }
+    template <class Function>
+    Value compute(const Key& key, Function update);
+    bool remove(const Key& key);
+
+    size_t size() const;
+private:
+    /**
+     * One independently locked HashMap. Aligned so that neighbouring
+     * shards' sequence counters do not share a cache line.
+     */
+    struct alignas(64) Shard {
+        Shard() : map(new HashMap<Key, Value>()) {}
+        ~Shard(){
+            delete map.load();
+        }
+
+        std::mutex lock;
+        std::atomic<uint64_t> seq{0}; // Odd while a write is in progress
+        std::atomic<HashMap<Key, Value>*> map;
+        std::atomic<int> size{0};
+    };
+
+    /**
+     * Scoped write to a shard whose lock is already held: keeps its
+     * sequence number odd for the duration.
+     */
+    class Writer {
+    public:
+        Writer(Shard& shard) : shard_(shard) {
+            uint64_t seq = shard_.seq.load(std::memory_order_relaxed);
+            shard_.seq.store(seq + 1, std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_release);
+        }
+        ~Writer(){
+            uint64_t seq = shard_.seq.load(std::memory_order_relaxed);
+            shard_.seq.store(seq + 1, std::memory_order_release);
+        }
+    private:
+        Shard& shard_;
+    };
+
+    Shard& shard_for(const Key& key) const {
+        return shards_[mix_hash(hashcode(key)) >> shift_];
+    }
+    HashMap<Key, Value>* writable(Shard& shard);
+
+    static void destroy(void* map){
+        delete static_cast<HashMap<Key, Value>*>(map);
+    }
+
+    Hash<Key> hashcode;
+    int shardCount_;
+    int shift_; // Selects the top bits of a mixed hash as the shard index
+    std::unique_ptr<Shard[]> shards_;
+};
+
+/**
+ * Constructs an empty map with the given number of shards, rounded up to
+ * a power of two (and at least two).
+ */
+template <class Key, class Value>
+ConcurrentHashMap<Key, Value>::ConcurrentHashMap(int shards){
+    int bits = 1;
+    while ((1 << bits) < shards){
+        bits++;
+    }
+    shardCount_ = 1 << bits;
+    shift_ = sizeof(size_t) * 8 - bits;
+    shards_.reset(new Shard[shardCount_]);
+}
+
+template <class Key, class Value>
+ConcurrentHashMap<Key, Value>::~ConcurrentHashMap(){}
+
+/**
+ * Copies the value at key into value and returns true, or returns false
+ * if the key is not present. Never blocks on writers; it retries if a
+ * write to the same shard overlapped it.
+ */
+template <class Key, class Value>
+bool ConcurrentHashMap<Key, Value>::get(const Key& key, Value& value) const {
+    Shard& shard = shard_for(key);
+    Epoch::Guard guard;
+    while (true){
+        uint64_t seq = shard.seq.load(std::memory_order_acquire);
+        if (seq & 1){
+            std::this_thread::yield();
+            continue;
+        }
+        const Value* found = shard.map.load(std::memory_order_acquire)->find(key);
+        Value copy;
+        if (found){
+            copy = *found;
+        }
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (shard.seq.load(std::memory_order_relaxed) == seq){
+            if (found){
+                value = copy;
+            }
+            return found != nullptr;
+        }
+    }
+}
+
+/**
+ * Returns true if the key is contained in the map. Never blocks on
+ * writers.
+ */
+template <class Key, class Value>
+bool ConcurrentHashMap<Key, Value>::contains(const Key& key) const {
+    Shard& shard = shard_for(key);
+    Epoch::Guard guard;
+    while (true){
+        uint64_t seq = shard.seq.load(std::memory_order_acquire);
+        if (seq & 1){
+            std::this_thread::yield();
+            continue;
+        }
+        bool found = shard.map.load(std::memory_order_acquire)->contains(key);
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (shard.seq.load(std::memory_order_relaxed) == seq){
+            return found;
+        }
+    }
+}
+
+/**
+ * Returns the shard's table, first replacing it if the next insert would
+ * otherwise rehash it in place under a reader. The new table holds only
+ * the live pairs, with room for as many again, so a table clogged with
+ * tombstones is replaced by one of the same size or smaller. Must be
+ * called with the shard's lock held.
+ */
+template <class Key, class Value>
+HashMap<Key, Value>* ConcurrentHashMap<Key, Value>::writable(Shard& shard){
+    HashMap<Key, Value>* map = shard.map.load(std::memory_order_relaxed);
+    if (map->size() + 1 <= static_cast<size_t>(map->capacity())){
+        return map;
+    }
+    HashMap<Key, Value>* fresh = new HashMap<Key, Value>();
+    fresh->set_max_load(map->max_load());
+    fresh->reserve(2 * map->size() + 1);
+    for (auto iter = map->begin(); iter != map->end(); iter++){
+        auto pair = *iter;
+        fresh->put(pair.first, pair.second);
+    }
+
+    shard.map.store(fresh, std::memory_order_release);
+    Epoch::retire(map, &destroy);
+    return fresh;
+}
+
+/**
+ * Inserts the key-value pair, or replaces the value if the key is already
+ * present. Returns true if the key was inserted.
+ */
+template <class Key, class Value>
+bool ConcurrentHashMap<Key, Value>::insert_or_assign(const Key& key, const Value& value){
+    Shard& shard = shard_for(key);
+    std::lock_guard<std::mutex> guard(shard.lock);
+
+    HashMap<Key, Value>* map = writable(shard);
+    Value* found = map->find(key);
+
+    Writer writer(shard);
+    if (found){
+        *found = value;
+        return false;
+    }
+    map->put(key, value);
+    shard.size.fetch_add(1, std::memory_order_relaxed);
+    return true;
+}
+
+/**
+ * Atomically replaces the value at key with update(value), where value is
+ * default-constructed if the key is not present. Returns the new value.
+ *
+ * update runs with the shard locked, so it should be short and must not
+ * access the map.
+ */
+template <class Key, class Value>
+template <class Function>
+Value ConcurrentHashMap<Key, Value>::compute(const Key& key, Function update){
+    Shard& shard = shard_for(key);
+    std::lock_guard<std::mutex> guard(shard.lock);
+
+    HashMap<Key, Value>* map = writable(shard);
+    const Value* found = map->find(key);
+    Value result = update(found ? *found : Value());
+
+    Writer writer(shard);
+    if (!found){
+        shard.size.fetch_add(1, std::memory_order_relaxed);
+    }
+    map->put(key, result);
+    return result;
+}
+
+/**
+ * Removes the key from the map. Returns true if it was present.
+ */
+template <class Key, class Value>
+bool ConcurrentHashMap<Key, Value>::remove(const Key& key){
+    Shard& shard = shard_for(key);
+    std::lock_guard<std::mutex> guard(shard.lock);
+
+    HashMap<Key, Value>* map = shard.map.load(std::memory_order_relaxed);
+    if (!map->contains(key)){
+        return false;
+    }
+    Writer writer(shard);
+    map->remove(key);
+    shard.size.fetch_sub(1, std::memory_order_relaxed);
+    return true;
+}
+
+/**
+ * Returns the number of key-value pairs. Writes that are in progress may
+ * or may not be counted.
+ */
+template <class Key, class Value>
+size_t ConcurrentHashMap<Key, Value>::size() const {
+    size_t total = 0;
+    for (int i = 0; i < shardCount_; i++){
+        total += shards_[i].size.load(std::memory_order_relaxed);
+    }
+    return total;
+}
+
+#endif // CONCURRENT_HASH_MAP_H_
@@ -0,0 +1,82 @@
+/*
+ * Throughput of ConcurrentHashMap against a HashMap behind one global
+ * mutex, for a read-mostly workload over a range of thread counts.
+ *
+ * Build with optimizations, e.g.
+ *     g++ -std=c++17 -O2 -pthread ConcurrentHashMapBench.cpp
+ */
+#include <iostream>
+#include <iomanip>
+#include <chrono>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <random>
+
+#include "ConcurrentHashMap.h"
+#include "HashMap.h"
+
+const int KEYS = 1 << 20;
+const int OPS_PER_THREAD = 2000000;
+const int WRITE_PERCENT = 10;
+
+/**
+ * Runs OPS_PER_THREAD operations on each of threads threads and returns
+ * the total throughput in millions of operations per second.
+ */
+template <class Op>
+double run(int threads, Op op){
+    std::vector<std::thread> workers;
+    auto start = std::chrono::steady_clock::now();
+    for (int t = 0; t < threads; t++){
+        workers.emplace_back([t, &op]{
+            std::mt19937 rng(t);
+            std::uniform_int_distribution<int> key(0, KEYS - 1);
+            std::uniform_int_distribution<int> percent(0, 99);
+            for (int i = 0; i < OPS_PER_THREAD; i++){
+                op(key(rng), percent(rng) < WRITE_PERCENT);
+            }
+        });
+    }
+    for (auto& w : workers){
+        w.join();
+    }
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    return threads * OPS_PER_THREAD / elapsed.count() / 1e6;
+}
+
+int main()
+{
+    int maxThreads = std::max(1u, std::thread::hardware_concurrency());
+
+    ConcurrentHashMap<int, int> sharded;
+    HashMap<int, int> global;
+    std::mutex globalLock;
+    for (int i = 0; i < KEYS; i += 2){
+        sharded.put(i, i);
+        global.put(i, i);
+    }
+
+    std::cout << "threads  mutex+HashMap (Mops/s)  ConcurrentHashMap (Mops/s)" << std::endl;
+    for (int threads = 1; threads <= maxThreads; threads *= 2){
+        double locked = run(threads, [&](int key, bool write){
+            std::lock_guard<std::mutex> guard(globalLock);
+            if (write){
+                global.put(key, key);
+            } else {
+                global.contains(key);
+            }
+        });
+        double concurrent = run(threads, [&](int key, bool write){
+            if (write){
+                sharded.put(key, key);
+            } else {
+                sharded.contains(key);
+            }
+        });
+        std::cout << std::setw(7) << threads
+            << std::setw(24) << std::fixed << std::setprecision(1) << locked
+            << std::setw(28) << concurrent << std::endl;
+    }
+    return 0;
+}
@@ -0,0 +1,167 @@
+#define BOOST_TEST_MODULE ConcurrentHashMap test
+#include <iostream>
+#include <thread>
+#include <vector>
+#include <atomic>
+
+#include <boost/test/unit_test.hpp>
+
+#include "ConcurrentHashMap.h"
+
+BOOST_AUTO_TEST_CASE(single_thread_test){
+    ConcurrentHashMap<int, int> map;
+
+    BOOST_CHECK(map.insert_or_assign(1, 10));
+    BOOST_CHECK(!map.insert_or_assign(1, 11));
+    map.put(2, 20);
+
+    int value = 0;
+    BOOST_CHECK(map.get(1, value));
+    BOOST_CHECK_EQUAL(value, 11);
+    BOOST_CHECK(!map.get(3, value));
+    BOOST_CHECK_EQUAL(map.size(), 2);
+
+    BOOST_CHECK(map.remove(1));
+    BOOST_CHECK(!map.remove(1));
+    BOOST_CHECK(!map.contains(1));
+    BOOST_CHECK(map.contains(2));
+    BOOST_CHECK_EQUAL(map.size(), 1);
+}
+
+BOOST_AUTO_TEST_CASE(parallel_insert_test){
+    const int THREADS = 8;
+    const int PER_THREAD = 20000;
+
+    ConcurrentHashMap<int, int> map(4);
+    std::vector<std::thread> threads;
+    for (int t = 0; t < THREADS; t++){
+        threads.emplace_back([&map, t]{
+            for (int i = t * PER_THREAD; i < (t + 1) * PER_THREAD; i++){
+                map.put(i, 2 * i);
+            }
+        });
+    }
+    for (auto& t : threads){
+        t.join();
+    }
+
+    BOOST_CHECK_EQUAL(map.size(), THREADS * PER_THREAD);
+    for (int i = 0; i < THREADS * PER_THREAD; i++){
+        int value = -1;
+        BOOST_REQUIRE(map.get(i, value));
+        BOOST_CHECK_EQUAL(value, 2 * i);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(compute_test){
+    const int THREADS = 8;
+    const int INCREMENTS = 10000;
+    const int KEYS = 16;
+
+    ConcurrentHashMap<int, long> map;
+    std::vector<std::thread> threads;
+    for (int t = 0; t < THREADS; t++){
+        threads.emplace_back([&map]{
+            for (int i = 0; i < INCREMENTS; i++){
+                map.compute(i % KEYS, [](long count){ return count + 1; });
+            }
+        });
+    }
+    for (auto& t : threads){
+        t.join();
+    }
+
+    BOOST_CHECK_EQUAL(map.size(), KEYS);
+    for (int key = 0; key < KEYS; key++){
+        long value = 0;
+        map.get(key, value);
+        BOOST_CHECK_EQUAL(value, THREADS * INCREMENTS / KEYS);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(readers_during_writes_test){
+    // Readers must never observe a torn value while writers grow the map
+    const int KEYS = 50000;
+
+    struct Twin {
+        long a;
+        long b;
+    };
+
+    ConcurrentHashMap<int, Twin> map(2);
+    std::atomic<bool> done(false);
+    std::atomic<int> torn(0);
+
+    std::vector<std::thread> readers;
+    for (int t = 0; t < 4; t++){
+        readers.emplace_back([&]{
+            while (!done.load()){
+                for (int i = 0; i < KEYS; i += 97){
+                    Twin value;
+                    if (map.get(i, value) && value.a != -value.b){
+                        torn++;
+                    }
+                }
+            }
+        });
+    }
+    for (long round = 1; round <= 3; round++){
+        for (int i = 0; i < KEYS; i++){
+            map.put(i, Twin{round * i, -round * i});
+        }
+    }
+    done = true;
+    for (auto& t : readers){
+        t.join();
+    }
+    BOOST_CHECK_EQUAL(torn.load(), 0);
+    BOOST_CHECK_EQUAL(map.size(), KEYS);
+}
+
+BOOST_AUTO_TEST_CASE(churn_test){
+    // Keys come and go behind a sliding window while the map grows, so
+    // tables are replaced, with tombstones in them, under the readers.
+    // Readers must keep finding the keys that stay, and replaced tables
+    // must be deleted rather than kept until the map is
+    const int STABLE = 2000;
+    const int WINDOW = 4000;
+    const int CHURN = 500000;
+
+    ConcurrentHashMap<int, int> map(2);
+    for (int i = 0; i < STABLE; i++){
+        map.put(i, i);
+    }
+    std::atomic<bool> done(false);
+    std::atomic<int> missing(0);
+
+    std::vector<std::thread> readers;
+    for (int t = 0; t < 2; t++){
+        readers.emplace_back([&]{
+            while (!done.load()){
+                for (int i = 0; i < STABLE; i += 7){
+                    int value;
+                    if (!map.get(i, value) || value != i){
+                        missing++;
+                    }
+                }
+            }
+        });
+    }
+    size_t before = Epoch::pending();
+    for (int i = STABLE; i < STABLE + CHURN; i++){
+        map.put(i, i);
+        if (i >= STABLE + WINDOW){
+            map.remove(i - WINDOW);
+        }
+    }
+    done = true;
+    for (auto& t : readers){
+        t.join();
+    }
+    BOOST_CHECK_EQUAL(missing.load(), 0);
+    BOOST_CHECK_EQUAL(map.size(), STABLE + WINDOW);
+
+    // This thread retired every replaced table; at most three epochs'
+    // worth can be waiting
+    BOOST_CHECK_LT(Epoch::pending(), before + 3 * 64);
+}
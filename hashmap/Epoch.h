@@ -0,0 +1,240 @@
+/*
+ * Copyright (C) 2013 Christian Briones
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense, 
+ * and/or sell copies of the Software, and to permit persons to whom the 
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included 
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, 
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES 
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR
+ * ANY CLAIM, DAMAGES, OR OTHER LIABILITY, WHETHER IN AN ACTION OF
+ * CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+ * WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef EPOCH_H_
+#define EPOCH_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <atomic>
+#include <utility>
+#include <vector>
+
+/**
+ * Epoch-based memory reclamation for lock-free containers.
+ *
+ * A thread holds a Guard for as long as it may follow pointers into a
+ * container, and a container retires an object, rather than deleting it,
+ * once the object has been unlinked. A retired object is deleted only
+ * after every thread that might still hold a pointer to it has dropped
+ * its Guard.
+ *
+ * A global epoch counts up. Each thread announces the epoch it saw when
+ * it took its Guard, and the epoch only advances once every thread with a
+ * Guard has seen the current one, so the epoch is never more than one
+ * ahead of any thread still inside a Guard. An object is tagged with the
+ * epoch read after it was unlinked, and any thread that can still reach
+ * it took its Guard in that epoch or earlier. So once the epoch is two
+ * past the tag, no thread can reach the object.
+ *
+ * Threads keep their own lists of retired objects, in three buckets by
+ * epoch, and free a bucket once it is old enough. A thread's record,
+ * along with anything it retired but has not yet freed, passes to the
+ * next thread to start once it exits.
+ */
+class Epoch {
+public:
+    class Guard;
+
+    /**
+     * Deletes object with destroy once no thread can still reach it. The
+     * object must already be unreachable for any thread that takes a
+     * Guard from now on.
+     */
+    static void retire(void* object, void (*destroy)(void*));
+
+    /**
+     * The number of objects this thread has retired that are not yet
+     * deleted.
+     */
+    static size_t pending();
+private:
+    struct Bucket {
+        uint64_t epoch = 0;
+        std::vector<std::pair<void*, void (*)(void*)> > garbage;
+
+        void free(){
+            for (auto& object : garbage){
+                object.second(object.first);
+            }
+            garbage.clear();
+        }
+    };
+
+    struct Record {
+        // The epoch shifted up by one, with the low bit set while the
+        // thread holds a Guard
+        std::atomic<uint64_t> state{0};
+        std::atomic<bool> used{true};
+        Record* next = nullptr;
+
+        // Only ever touched by the thread that owns the record
+        int depth = 0;
+        int retires = 0;
+        Bucket limbo[3];
+    };
+
+    // Retires between attempts to advance the epoch
+    static const int ADVANCE_INTERVAL = 64;
+
+    static std::atomic<uint64_t>& global(){
+        static std::atomic<uint64_t> epoch{0};
+        return epoch;
+    }
+    static std::atomic<Record*>& records(){
+        static std::atomic<Record*> head{nullptr};
+        return head;
+    }
+
+    static Record& local();
+    static void enter();
+    static void exit();
+    static void advance(uint64_t epoch);
+    static void collect(Record& record, uint64_t epoch);
+};
+
+/**
+ * Keeps every object the holding thread can reach from being deleted.
+ * Guards nest, and copies are Guards of their own.
+ */
+class Epoch::Guard {
+public:
+    Guard(){
+        enter();
+    }
+    Guard(const Guard&){
+        enter();
+    }
+    Guard& operator=(const Guard&){
+        return *this;
+    }
+    ~Guard(){
+        exit();
+    }
+};
+
+/**
+ * The record of the calling thread, which it claims from a thread that
+ * has exited, or adds, the first time it asks.
+ */
+inline Epoch::Record& Epoch::local(){
+    struct Owner {
+        Record* record;
+
+        Owner(){
+            for (record = records().load(std::memory_order_acquire); record; record = record->next){
+                bool free = false;
+                if (!record->used.load(std::memory_order_relaxed) &&
+                        record->used.compare_exchange_strong(free, true, std::memory_order_acquire)){
+                    return;
+                }
+            }
+            record = new Record;
+            Record* head = records().load(std::memory_order_relaxed);
+            do {
+                record->next = head;
+            } while (!records().compare_exchange_weak(head, record, std::memory_order_release));
+        }
+        ~Owner(){
+            record->used.store(false, std::memory_order_release);
+        }
+    };
+    static thread_local Owner owner;
+    return *owner.record;
+}
+
+inline void Epoch::enter(){
+    Record& record = local();
+    if (record.depth++ > 0){
+        return;
+    }
+    uint64_t epoch = global().load(std::memory_order_seq_cst);
+
+    // The announcement must be visible before the thread reads any
+    // pointer. A locked exchange orders it as a full fence would, for less
+    record.state.exchange((epoch << 1) | 1, std::memory_order_seq_cst);
+    collect(record, epoch);
+}
+
+inline void Epoch::exit(){
+    Record& record = local();
+    if (--record.depth == 0){
+        record.state.store(0, std::memory_order_release);
+    }
+}
+
+inline void Epoch::retire(void* object, void (*destroy)(void*)){
+    Record& record = local();
+    uint64_t epoch = global().load(std::memory_order_seq_cst);
+
+    // A bucket last used three or more epochs ago is safe to empty
+    Bucket& bucket = record.limbo[epoch % 3];
+    if (bucket.epoch != epoch){
+        bucket.free();
+        bucket.epoch = epoch;
+    }
+    bucket.garbage.emplace_back(object, destroy);
+
+    if (++record.retires >= ADVANCE_INTERVAL){
+        record.retires = 0;
+        advance(epoch);
+        collect(record, global().load(std::memory_order_seq_cst));
+    }
+}
+
+/**
+ * Moves the global epoch on from epoch, if every thread holding a Guard
+ * has seen it.
+ */
+inline void Epoch::advance(uint64_t epoch){
+    for (Record* record = records().load(std::memory_order_acquire); record; record = record->next){
+        uint64_t state = record->state.load(std::memory_order_seq_cst);
+        if ((state & 1) && (state >> 1) != epoch){
+            return;
+        }
+    }
+    global().compare_exchange_strong(epoch, epoch + 1, std::memory_order_seq_cst);
+}
+
+/**
+ * Deletes the objects in the record's buckets that are two or more epochs
+ * older than epoch.
+ */
+inline void Epoch::collect(Record& record, uint64_t epoch){
+    for (Bucket& bucket : record.limbo){
+        if (!bucket.garbage.empty() && bucket.epoch + 2 <= epoch){
+            bucket.free();
+        }
+    }
+}
+
+inline size_t Epoch::pending(){
+    Record& record = local();
+    size_t count = 0;
+    for (Bucket& bucket : record.limbo){
+        count += bucket.garbage.size();
+    }
+    return count;
+}
+
+#endif // EPOCH_H_
@@ -0,0 +1,160 @@
+/*
+ * Copyright (C) 2013 Christian Briones
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense, 
+ * and/or sell copies of the Software, and to permit persons to whom the 
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included 
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, 
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES 
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR
+ * ANY CLAIM, DAMAGES, OR OTHER LIABILITY, WHETHER IN AN ACTION OF
+ * CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+ * WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef GROUP_H_
+#define GROUP_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+/*
+ * Control bytes for group-probed hash tables.
+ *
+ * Every slot in the table has one control byte. A full slot stores a 7-bit
+ * fragment of its key's hash (h2), so its high bit is clear; empty and
+ * deleted slots have the high bit set. Probing loads a whole group of
+ * control bytes at once and only compares full keys where the fragment
+ * matches.
+ */
+const int8_t CTRL_EMPTY = -128;  // 0b10000000
+const int8_t CTRL_DELETED = -2;  // 0b11111110
+
+/**
+ * Returns the 7-bit fragment of hash stored in the control byte.
+ */
+inline int8_t h2(size_t hash){
+    return static_cast<int8_t>(hash & 0x7f);
+}
+
+/**
+ * Returns the part of hash used to pick the starting group of a probe.
+ */
+inline size_t h1(size_t hash){
+    return hash >> 7;
+}
+
+/**
+ * Index of the lowest set bit in a non-zero group bitmask.
+ */
+inline int lowest_bit(uint32_t mask){
+    return __builtin_ctz(mask);
+}
+
+/**
+ * A group of consecutive control bytes, loaded and matched in one step.
+ * Matches are returned as a bitmask with bit i set for the i-th slot of
+ * the group.
+ */
+struct Group {
+#if defined(__AVX2__)
+    static const int WIDTH = 32;
+
+    explicit Group(const int8_t* pos) :
+        ctrl(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(pos))) {}
+
+    uint32_t match(int8_t hash) const {
+        return _mm256_movemask_epi8(_mm256_cmpeq_epi8(ctrl, _mm256_set1_epi8(hash)));
+    }
+    uint32_t match_empty() const {
+        return match(CTRL_EMPTY);
+    }
+    uint32_t match_empty_or_deleted() const {
+        return _mm256_movemask_epi8(ctrl);
+    }
+    uint32_t match_full() const {
+        return ~match_empty_or_deleted();
+    }
+
+    __m256i ctrl;
+#elif defined(__SSE2__)
+    static const int WIDTH = 16;
+
+    explicit Group(const int8_t* pos) :
+        ctrl(_mm_loadu_si128(reinterpret_cast<const __m128i*>(pos))) {}
+
+    uint32_t match(int8_t hash) const {
+        return _mm_movemask_epi8(_mm_cmpeq_epi8(ctrl, _mm_set1_epi8(hash)));
+    }
+    uint32_t match_empty() const {
+        return match(CTRL_EMPTY);
+    }
+    uint32_t match_empty_or_deleted() const {
+        return _mm_movemask_epi8(ctrl);
+    }
+    uint32_t match_full() const {
+        return ~match_empty_or_deleted() & 0xffff;
+    }
+
+    __m128i ctrl;
+#else
+    static const int WIDTH = 16;
+
+    explicit Group(const int8_t* pos){
+        for (int i = 0; i < WIDTH; i++){
+            ctrl[i] = pos[i];
+        }
+    }
+
+    uint32_t match(int8_t hash) const {
+        uint32_t mask = 0;
+        for (int i = 0; i < WIDTH; i++){
+            mask |= static_cast<uint32_t>(ctrl[i] == hash) << i;
+        }
+        return mask;
+    }
+    uint32_t match_empty() const {
+        return match(CTRL_EMPTY);
+    }
+    uint32_t match_empty_or_deleted() const {
+        uint32_t mask = 0;
+        for (int i = 0; i < WIDTH; i++){
+            mask |= static_cast<uint32_t>(ctrl[i] < 0) << i;
+        }
+        return mask;
+    }
+    uint32_t match_full() const {
+        return ~match_empty_or_deleted() & 0xffff;
+    }
+
+    int8_t ctrl[WIDTH];
+#endif
+};
+
+/**
+ * Rounds n up to a power of two of at least one group, so that groups can
+ * be indexed with a mask.
+ */
+inline int table_capacity(int n){
+    int capacity = Group::WIDTH;
+    while (capacity < n){
+        capacity *= 2;
+    }
+    return capacity;
+}
+
+#endif // GROUP_H_
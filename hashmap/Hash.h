@@ -2,31 +2,324 @@
 #define HASH_H_
 
 #include <stddef.h>
+#include <stdint.h>
+#include <string.h>
 #include <string>
+#include <tuple>
+#include <type_traits>
+#include <utility>
 
-template <typename Key>
+#if __cplusplus >= 201703L
+#include <string_view>
+#endif
+
+/*
+ * Hash functions used by the hash containers.
+ *
+ * Everything is built on a 64x64->128 bit multiply that folds the high half
+ * of the product into the low half (the "mum" of wyhash). Strings are
+ * hashed eight bytes at a time, in three independent lanes for long keys.
+ *
+ * All hashers mix in a seed. It is zero unless the program calls
+ * set_hash_seed, for example with a random value at startup to defend
+ * against hash flooding. Each Hash object takes the seed when it is
+ * constructed, so containers must not outlive a change of seed.
+ */
+namespace hash_detail {
+    const uint64_t P0 = 0xa0761d6478bd642full;
+    const uint64_t P1 = 0xe7037ed1a0b428dbull;
+    const uint64_t P2 = 0x8ebc6af09c88c6e3ull;
+    const uint64_t P3 = 0x589965cc75374cc3ull;
+
+    inline uint64_t mum(uint64_t a, uint64_t b){
+        __uint128_t product = static_cast<__uint128_t>(a) * b;
+        return static_cast<uint64_t>(product) ^ static_cast<uint64_t>(product >> 64);
+    }
+    inline uint64_t read64(const uint8_t* p){
+        uint64_t v;
+        memcpy(&v, p, 8);
+        return v;
+    }
+    inline uint64_t read32(const uint8_t* p){
+        uint32_t v;
+        memcpy(&v, p, 4);
+        return v;
+    }
+    inline uint64_t& seed(){
+        static uint64_t seed = 0;
+        return seed;
+    }
+
+    /**
+     * Constructs a hasher with the given seed, or default-constructs one
+     * that does not take a seed (such as a user-supplied specialization).
+     */
+    template <typename Hasher>
+    typename std::enable_if<std::is_constructible<Hasher, uint64_t>::value, Hasher>::type
+    make_hasher(uint64_t seed){
+        return Hasher(seed);
+    }
+    template <typename Hasher>
+    typename std::enable_if<!std::is_constructible<Hasher, uint64_t>::value, Hasher>::type
+    make_hasher(uint64_t){
+        return Hasher();
+    }
+
+    template <typename T>
+    struct Void {
+        typedef void type;
+    };
+}
+
+/**
+ * Sets the seed mixed into every Hash constructed from now on.
+ */
+inline void set_hash_seed(uint64_t seed){
+    hash_detail::seed() = seed;
+}
+
+inline uint64_t hash_seed(){
+    return hash_detail::seed();
+}
+
+namespace hash_detail {
+    /**
+     * Reads len bytes starting at data into a 128-bit product, which the
+     * hash functions below fold down to their result.
+     */
+    inline __uint128_t absorb(const void* data, size_t len, uint64_t seed){
+        const uint8_t* p = static_cast<const uint8_t*>(data);
+        seed ^= mum(seed ^ P0, P1);
+
+        uint64_t a, b;
+        if (len <= 16){
+            if (len >= 4){
+                // Two possibly overlapping reads from each end cover 4-16 bytes
+                size_t mid = (len >> 3) << 2;
+                a = (read32(p) << 32) | read32(p + mid);
+                b = (read32(p + len - 4) << 32) | read32(p + len - 4 - mid);
+            } else if (len > 0){
+                a = (static_cast<uint64_t>(p[0]) << 16) | (static_cast<uint64_t>(p[len >> 1]) << 8) | p[len - 1];
+                b = 0;
+            } else {
+                a = b = 0;
+            }
+        } else {
+            size_t i = len;
+            if (i > 48){
+                uint64_t lane1 = seed, lane2 = seed;
+                do {
+                    seed = mum(read64(p) ^ P1, read64(p + 8) ^ seed);
+                    lane1 = mum(read64(p + 16) ^ P2, read64(p + 24) ^ lane1);
+                    lane2 = mum(read64(p + 32) ^ P3, read64(p + 40) ^ lane2);
+                    p += 48;
+                    i -= 48;
+                } while (i > 48);
+                seed ^= lane1 ^ lane2;
+            }
+            while (i > 16){
+                seed = mum(read64(p) ^ P1, read64(p + 8) ^ seed);
+                p += 16;
+                i -= 16;
+            }
+            // The last 16 bytes, overlapping what came before if need be
+            a = read64(p + i - 16);
+            b = read64(p + i - 8);
+        }
+        return static_cast<__uint128_t>(a ^ P1) * (b ^ seed);
+    }
+}
+
+/**
+ * Hashes len bytes starting at data.
+ */
+inline uint64_t hash_bytes(const void* data, size_t len, uint64_t seed){
+    using namespace hash_detail;
+
+    __uint128_t product = absorb(data, len, seed);
+    return mum(static_cast<uint64_t>(product) ^ P0 ^ len, static_cast<uint64_t>(product >> 64) ^ P1);
+}
+
+/**
+ * A 128-bit hash, as two independent 64-bit halves.
+ */
+struct Hash128 {
+    uint64_t low;
+    uint64_t high;
+};
+
+/**
+ * Hashes len bytes starting at data to 128 bits, for callers that need
+ * more than one hash per key. The low half equals hash_bytes, and the high
+ * half costs one more multiply.
+ */
+inline Hash128 hash_bytes128(const void* data, size_t len, uint64_t seed){
+    using namespace hash_detail;
+
+    __uint128_t product = absorb(data, len, seed);
+    uint64_t low = static_cast<uint64_t>(product), high = static_cast<uint64_t>(product >> 64);
+    Hash128 hash = { mum(low ^ P0 ^ len, high ^ P1), mum(low ^ P2 ^ len, high ^ P3) };
+    return hash;
+}
+
+/**
+ * Hashes a 64-bit integer.
+ */
+inline uint64_t hash_int(uint64_t k, uint64_t seed){
+    return hash_detail::mum(k ^ seed ^ hash_detail::P0, hash_detail::P1);
+}
+
+/**
+ * Combines the hash of another value into hash, for composite keys.
+ */
+inline uint64_t hash_combine(uint64_t hash, uint64_t value){
+    return hash_detail::mum(hash ^ hash_detail::P2, value ^ hash_detail::P3);
+}
+
+/**
+ * True if Hasher declares an is_transparent member type, meaning it can
+ * hash other types directly, to the same value as the Key they compare
+ * equal to. Containers then accept those types for lookups.
+ */
+template <typename Hasher, typename Enable = void>
+struct is_transparent : std::false_type {};
+
+template <typename Hasher>
+struct is_transparent<Hasher, typename hash_detail::Void<typename Hasher::is_transparent>::type> : std::true_type {};
+
+template <typename Key, typename Enable = void>
 struct Hash {
     Hash(){};
     size_t operator()(const Key& k) const;
 };
 
-template <>
-struct Hash<int> {
-    inline size_t operator()(const int& k) const { 
-        return k & 0x7fffffff; 
-    };
+/**
+ * Hashes every integral and enumeration type.
+ */
+template <typename Key>
+struct Hash<Key, typename std::enable_if<std::is_integral<Key>::value || std::is_enum<Key>::value>::type> {
+    Hash(uint64_t seed = hash_seed()) : seed_(seed) {}
+
+    inline size_t operator()(const Key& k) const {
+        return hash_int(static_cast<uint64_t>(k), seed_);
+    }
+private:
+    uint64_t seed_;
+};
+
+/**
+ * Hashes a pointer by its address.
+ */
+template <typename T>
+struct Hash<T*> {
+    Hash(uint64_t seed = hash_seed()) : seed_(seed) {}
+
+    inline size_t operator()(T* const& k) const {
+        return hash_int(reinterpret_cast<uintptr_t>(k), seed_);
+    }
+private:
+    uint64_t seed_;
 };
 
+/**
+ * Hashes std::string, and C strings and string_views to the same values as
+ * the equal std::string.
+ */
 template <>
 struct Hash<std::string> {
+    typedef void is_transparent;
+
+    Hash(uint64_t seed = hash_seed()) : seed_(seed) {}
+
     size_t operator()(const std::string& k) const {
-        int hash = 5381;
+        return hash_bytes(k.data(), k.size(), seed_);
+    };
+    size_t operator()(const char* k) const {
+        return hash_bytes(k, strlen(k), seed_);
+    };
+#if __cplusplus >= 201703L
+    size_t operator()(std::string_view k) const {
+        return hash_bytes(k.data(), k.size(), seed_);
+    };
+#endif
+private:
+    uint64_t seed_;
+};
+
+#if __cplusplus >= 201703L
+/**
+ * Hashes a string_view to the same value as the equal std::string.
+ */
+template <>
+struct Hash<std::string_view> {
+    Hash(uint64_t seed = hash_seed()) : seed_(seed) {}
 
-        for (auto& chr : k){
-            hash = ((hash << 5) + hash) + chr;
+    size_t operator()(const std::string_view& k) const {
+        return hash_bytes(k.data(), k.size(), seed_);
+    };
+private:
+    uint64_t seed_;
+};
+#endif
+
+template <typename First, typename Second>
+struct Hash<std::pair<First, Second> > {
+    Hash(uint64_t seed = hash_seed()) :
+        first_(hash_detail::make_hasher<Hash<typename std::decay<First>::type> >(seed)),
+        second_(hash_detail::make_hasher<Hash<typename std::decay<Second>::type> >(seed)) {}
+
+    size_t operator()(const std::pair<First, Second>& k) const {
+        return hash_combine(first_(k.first), second_(k.second));
+    }
+private:
+    Hash<typename std::decay<First>::type> first_;
+    Hash<typename std::decay<Second>::type> second_;
+};
+
+namespace hash_detail {
+    /**
+     * Folds the hashes of the elements of a tuple from index I on into
+     * hash.
+     */
+    template <size_t I, typename Tuple, bool Done = (I == std::tuple_size<Tuple>::value)>
+    struct TupleHash {
+        static uint64_t combine(uint64_t hash, const Tuple& k, uint64_t seed){
+            typedef typename std::decay<typename std::tuple_element<I, Tuple>::type>::type Element;
+            uint64_t element = make_hasher<Hash<Element> >(seed)(std::get<I>(k));
+            return TupleHash<I + 1, Tuple>::combine(hash_combine(hash, element), k, seed);
         }
-        return hash & 0x7fffffff;
     };
+
+    template <size_t I, typename Tuple>
+    struct TupleHash<I, Tuple, true> {
+        static uint64_t combine(uint64_t hash, const Tuple&, uint64_t){
+            return hash;
+        }
+    };
+}
+
+template <typename... Types>
+struct Hash<std::tuple<Types...> > {
+    Hash(uint64_t seed = hash_seed()) : seed_(seed) {}
+
+    size_t operator()(const std::tuple<Types...>& k) const {
+        return hash_detail::TupleHash<0, std::tuple<Types...> >::combine(seed_, k, seed_);
+    }
+private:
+    uint64_t seed_;
 };
 
+/**
+ * Fibonacci hashing stage applied to the output of Hash<Key> before it is
+ * used to index a table. Multiplying by 2^64 / phi spreads keys that only
+ * differ in their low bits across the whole word, and folding the high
+ * half back down lets both halves pick the slot. The built-in hashers are
+ * already well mixed; this guards the tables against weak user-supplied
+ * specializations.
+ */
+inline size_t mix_hash(size_t hash){
+    hash *= 11400714819323198485ull;
+    return hash ^ (hash >> 32);
+}
+
 #endif // HASH_H_
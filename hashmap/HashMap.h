@@ -26,16 +26,28 @@
 #include <vector>
 #include <string>
 #include <functional>
+#include <memory>
+#include <new>
+#include <utility>
+#include <algorithm>
+#include <iterator>
+#include <type_traits>
 
 #include <initializer_list>
 
 #include "Hash.h"
+#include "Group.h"
+
+// Tag selecting the Pair constructor that builds the value in place
+struct InPlace {};
 
 // Useful struct for iteration, mirrors std::pair
 template <class Key, class Value>
 struct Pair {
     Pair(){}
-    Pair(Key key, Value value) : first(key), second(value) {}
+    Pair(Key key, Value value) : first(std::forward<Key>(key)), second(std::forward<Value>(value)) {}
+    template <class K, class... Args>
+    Pair(InPlace, K&& key, Args&&... args) : first(std::forward<K>(key)), second(std::forward<Args>(args)...) {}
     Key first;
     Value second;
 };
@@ -47,21 +59,97 @@ Pair<Key, Value> create_pair(const Key& key, const Value& value){
 }
 
 /**
- * Hash Table container class implemented with linear probing
+ * Hash Table container class implemented with group probing.
+ *
+ * Key-value pairs are stored inline in a single contiguous slot array,
+ * alongside a parallel array of control bytes (see Group.h). The table is
+ * probed a group of slots at a time, and keys are only compared where the
+ * 7-bit hash fragment in the control byte matches.
+ *
+ * By default a resize rehashes every pair at once. With incremental
+ * resizing enabled, the old table is instead kept alongside the new one
+ * and drained a group at a time by each put, get and remove; lookups
+ * consult both tables until it is empty.
  */
 template <typename Key, typename Value>
 class HashMap {
+    template <class K>
+    using Lookup = typename std::enable_if<std::is_same<K, Key>::value || is_transparent<Hash<Key> >::value>::type;
 public:
     HashMap();
     HashMap(std::initializer_list<Pair<const Key&, const Value&> > list);
+    HashMap(const HashMap<Key, Value>& other);
+    HashMap(HashMap<Key, Value>&& other) noexcept;
+    HashMap<Key, Value>& operator=(const HashMap<Key, Value>& other);
+    HashMap<Key, Value>& operator=(HashMap<Key, Value>&& other) noexcept;
     ~HashMap();
 
-    void put(const Key& key, const Value& value);
+    template <class V = Value>
+    void put(const Key& key, V&& value){
+        insert_or_assign(key, std::forward<V>(value));
+    }
+    template <class V = Value>
+    void put(Key&& key, V&& value){
+        insert_or_assign(std::move(key), std::forward<V>(value));
+    }
     void put(Pair<const Key&, const Value&> pair);
-    Value& get(const Key& key);
-    void remove(const Key& key);
 
-    bool contains(const Key& key) const;
+    // Each returns true if a new pair was inserted, and false if the key
+    // was already present
+    template <class V = Value>
+    bool insert_or_assign(const Key& key, V&& value){
+        return assign(key, std::forward<V>(value));
+    }
+    template <class V = Value>
+    bool insert_or_assign(Key&& key, V&& value){
+        return assign(std::move(key), std::forward<V>(value));
+    }
+    template <class... Args>
+    bool try_emplace(const Key& key, Args&&... args){
+        return construct(key, std::forward<Args>(args)...);
+    }
+    template <class... Args>
+    bool try_emplace(Key&& key, Args&&... args){
+        return construct(std::move(key), std::forward<Args>(args)...);
+    }
+    template <class... Args>
+    bool emplace(Args&&... args);
+    template <class Iter>
+    void insert_bulk(Iter first, Iter last);
+    template <class Range>
+    void insert_bulk(const Range& range){
+        insert_bulk(std::begin(range), std::end(range));
+    }
+    Value& get(const Key& key){
+        return get<Key>(key);
+    }
+    Value& get(Key&& key);
+    Value* find(const Key& key){
+        return find<Key>(key);
+    }
+    const Value* find(const Key& key) const {
+        return find<Key>(key);
+    }
+    size_t find_batch(const Key* keys, size_t n, const Value** out) const;
+    void remove(const Key& key){
+        remove<Key>(key);
+    }
+    bool contains(const Key& key) const {
+        return contains<Key>(key);
+    }
+
+    // Lookups by any type Hash<Key> is transparent for, without
+    // constructing a Key (see is_transparent in Hash.h)
+    template <class K, class = Lookup<K> >
+    Value& get(const K& key);
+    template <class K, class = Lookup<K> >
+    Value* find(const K& key);
+    template <class K, class = Lookup<K> >
+    const Value* find(const K& key) const;
+    template <class K, class = Lookup<K> >
+    void remove(const K& key);
+    template <class K, class = Lookup<K> >
+    bool contains(const K& key) const;
 
     float max_load() const {
         return maxLoad_;
@@ -69,27 +157,93 @@ public:
     void set_max_load(float maxLoad){
         maxLoad_ = maxLoad;
     }
+    bool incremental_resize() const {
+        return incremental_;
+    }
+    void set_incremental_resize(bool incremental){
+        incremental_ = incremental;
+    }
+    bool resizing() const {
+        return oldSlots_ != nullptr;
+    }
     Value& operator[](const Key& key){
         return get(key);
     }
+    Value& operator[](Key&& key){
+        return get(std::move(key));
+    }
     size_t size() const;
+    int capacity() const;
+    void reserve(int n);
 
     class Iterator;
     Iterator begin() const;
     Iterator end() const;
 private:
-    int size_ = 0; // Number of key-value pairs
-    int tableSize_ = 41; // size of linear-probing table
+    typedef Pair<Key, Value> Slot;
+
+    // Number of keys hashed and prefetched ahead of probing by the bulk
+    // operations. Enough to cover memory latency, few enough that the
+    // prefetched lines are still in cache when they are probed.
+    static const int BATCH = 16;
+
+    int size_ = 0; // Number of key-value pairs, in both tables
+    int used_ = 0; // Number of slots that are not empty, including tombstones
+    int tableSize_ = table_capacity(41); // size of probing table
 
     float maxLoad_ = 0.25;
+    bool incremental_ = false;
     void resize(int newSize);
-    
+    void grow();
+    template <class K>
+    int find_index(const K& key) const;
+    template <class K>
+    int find_old(const K& key) const;
+    template <class K>
+    int insert_slot(const K& key, size_t hash, bool& found);
+    void prefetch(size_t hash) const;
+    int insert_new(size_t hash);
+    template <class K>
+    void adopt(const K& key);
+    template <class K, class V>
+    bool assign(K&& key, V&& value);
+    template <class K, class... Args>
+    bool construct(K&& key, Args&&... args);
+    void steal(HashMap<Key, Value>& other);
+    void migrate(int j);
+    void migrate_step();
+    void finish_migration();
+    void destroy();
+
+    template <class K>
+    static int probe(const Slot* slots, const int8_t* ctrl, int tableSize, const K& key, size_t hash);
+
+    bool full(int i) const {
+        return ctrl_[i] >= 0;
+    }
+    int groups() const {
+        return tableSize_ / Group::WIDTH;
+    }
+    size_t group_mask() const {
+        return groups() - 1;
+    }
+
     Hash<Key> hashcode;
-    std::vector< Pair<Key, Value>* > items_;
+    std::allocator<Slot> alloc_;
+    Slot* slots_ = nullptr; // Uninitialized except where the slot is full
+    std::vector<int8_t> ctrl_;
+
+    // The table an incremental resize is draining, if any. Its groups
+    // below oldGroup_ are already empty.
+    Slot* oldSlots_ = nullptr;
+    std::vector<int8_t> oldCtrl_;
+    int oldSize_ = 0;
+    int oldLive_ = 0; // Number of pairs still in the old table
+    int oldGroup_ = 0;
 };
 
 template <class Key, class Value>
-HashMap<Key, Value>::HashMap() : items_(tableSize_, nullptr) {}
+HashMap<Key, Value>::HashMap() : slots_(alloc_.allocate(tableSize_)), ctrl_(tableSize_, CTRL_EMPTY) {}
 
 template <class Key, class Value>
 HashMap<Key, Value>::HashMap(std::initializer_list<Pair<const Key&, const Value&> > list) : HashMap() {
@@ -98,40 +252,368 @@ HashMap<Key, Value>::HashMap(std::initializer_list<Pair<const Key&, const Value&
     }
 }
 
+template <class Key, class Value>
+HashMap<Key, Value>::HashMap(const HashMap<Key, Value>& other) :
+    size_(other.size_),
+    tableSize_(other.tableSize_),
+    maxLoad_(other.maxLoad_),
+    incremental_(other.incremental_),
+    hashcode(other.hashcode),
+    slots_(alloc_.allocate(other.tableSize_)),
+    ctrl_(other.tableSize_, CTRL_EMPTY)
+{
+    // Every pair is rehashed into a table without tombstones, so a copy is
+    // also a way to compact a map. Pairs cannot keep their slots, since a
+    // tombstone turned empty would cut short the probes that pass it.
+    for (int i = 0; i < tableSize_; i++){
+        if (other.full(i)){
+            int j = insert_new(mix_hash(hashcode(other.slots_[i].first)));
+            new (&slots_[j]) Slot(other.slots_[i]);
+        }
+    }
+    // Whatever the other map had left to migrate goes into the same table,
+    // which always has room for it.
+    for (int j = 0; j < other.oldSize_; j++){
+        if (other.oldCtrl_[j] >= 0){
+            int i = insert_new(mix_hash(hashcode(other.oldSlots_[j].first)));
+            new (&slots_[i]) Slot(other.oldSlots_[j]);
+        }
+    }
+}
+
+template <class Key, class Value>
+HashMap<Key, Value>::HashMap(HashMap<Key, Value>&& other) noexcept {
+    steal(other);
+}
+
+template <class Key, class Value>
+HashMap<Key, Value>& HashMap<Key, Value>::operator=(const HashMap<Key, Value>& other){
+    if (this != &other){
+        HashMap<Key, Value> copy(other);
+        destroy();
+        steal(copy);
+    }
+    return *this;
+}
+
+template <class Key, class Value>
+HashMap<Key, Value>& HashMap<Key, Value>::operator=(HashMap<Key, Value>&& other) noexcept {
+    if (this != &other){
+        destroy();
+        steal(other);
+    }
+    return *this;
+}
+
+/**
+ * Takes over the tables of other, which is left empty and without a table
+ * at all; its first insert allocates one. Anything this map owned must
+ * already have been released.
+ */
+template <class Key, class Value>
+void HashMap<Key, Value>::steal(HashMap<Key, Value>& other){
+    size_ = other.size_;
+    used_ = other.used_;
+    tableSize_ = other.tableSize_;
+    maxLoad_ = other.maxLoad_;
+    incremental_ = other.incremental_;
+    hashcode = other.hashcode;
+    slots_ = other.slots_;
+    ctrl_ = std::move(other.ctrl_);
+    oldSlots_ = other.oldSlots_;
+    oldCtrl_ = std::move(other.oldCtrl_);
+    oldSize_ = other.oldSize_;
+    oldLive_ = other.oldLive_;
+    oldGroup_ = other.oldGroup_;
+
+    other.size_ = other.used_ = other.tableSize_ = 0;
+    other.slots_ = other.oldSlots_ = nullptr;
+    other.ctrl_.clear();
+    other.oldCtrl_.clear();
+    other.oldSize_ = other.oldLive_ = other.oldGroup_ = 0;
+}
+
 template <class Key, class Value>
 HashMap<Key, Value>::~HashMap(){
+    destroy();
+}
+
+/**
+ * Destroys every stored pair and releases the slot arrays.
+ */
+template <class Key, class Value>
+void HashMap<Key, Value>::destroy(){
     for (int i = 0; i < tableSize_; i++){
-        if (items_[i]){
-            delete items_[i];
+        if (full(i)){
+            slots_[i].~Slot();
+        }
+    }
+    if (slots_){
+        alloc_.deallocate(slots_, tableSize_);
+    }
+    slots_ = nullptr;
+
+    for (int j = 0; j < oldSize_; j++){
+        if (oldCtrl_[j] >= 0){
+            oldSlots_[j].~Slot();
         }
     }
+    if (oldSlots_){
+        alloc_.deallocate(oldSlots_, oldSize_);
+    }
+    oldSlots_ = nullptr;
+    oldCtrl_.clear();
+    oldSize_ = oldLive_ = oldGroup_ = 0;
 }
 
 /**
- * Inserts the key-value pair into the HashMap.
+ * Returns the index of the slot in the given table holding key, or -1 if
+ * it is not present.
  */
 template <class Key, class Value>
-void HashMap<Key, Value>::put(const Key& key, const Value& value){
-    // Double the size of the linear-probing table if
-    // the load factor exceeds the max
-    if (size_ >= static_cast<int>(tableSize_ * maxLoad_)){
-        resize(tableSize_ * 2);
+template <class K>
+int HashMap<Key, Value>::probe(const Slot* slots, const int8_t* ctrl, int tableSize, const K& key, size_t hash){
+    int8_t fragment = h2(hash);
+    int groups = tableSize / Group::WIDTH;
+    int g = h1(hash) & (groups - 1);
+
+    for (int n = 0; n < groups; n++){
+        int base = g * Group::WIDTH;
+        Group group(&ctrl[base]);
+
+        for (uint32_t match = group.match(fragment); match; match &= match - 1){
+            int i = base + lowest_bit(match);
+            if (slots[i].first == key){
+                return i;
+            }
+        }
+        // An empty slot ends every probe sequence that reached this group
+        if (group.match_empty()){
+            return -1;
+        }
+        // Triangular probing visits every group of a power-of-two table
+        g = (g + n + 1) & (groups - 1);
     }
+    return -1;
+}
 
-    // Compute starting point of probe
-    int i = hashcode(key) % tableSize_;
-    // Probe for empty slot
-    for(; items_[i]; i = (i + 1) % tableSize_){
-        if (items_[i]->first == key){
-            items_[i]->second = value;
-            return;
+/**
+ * Returns the index of the slot holding key in the current table, or -1
+ * if it is not there.
+ */
+template <class Key, class Value>
+template <class K>
+int HashMap<Key, Value>::find_index(const K& key) const {
+    return probe(slots_, ctrl_.data(), tableSize_, key, mix_hash(hashcode(key)));
+}
+
+/**
+ * Returns the index of the slot holding key in the table being drained by
+ * an incremental resize, or -1 if it is not there.
+ */
+template <class Key, class Value>
+template <class K>
+int HashMap<Key, Value>::find_old(const K& key) const {
+    if (!oldSlots_){
+        return -1;
+    }
+    return probe(oldSlots_, oldCtrl_.data(), oldSize_, key, mix_hash(hashcode(key)));
+}
+
+/**
+ * Returns the index of the slot holding key if present, and sets found.
+ * Otherwise returns the slot a new pair for key should be constructed in,
+ * preferring the first tombstone along the probe sequence, and marks it
+ * full.
+ */
+template <class Key, class Value>
+template <class K>
+int HashMap<Key, Value>::insert_slot(const K& key, size_t hash, bool& found){
+    grow();
+    if (oldSlots_){
+        migrate_step();
+        adopt(key);
+    }
+
+    int8_t fragment = h2(hash);
+    int g = h1(hash) & group_mask();
+    int target = -1;
+
+    found = false;
+    for (int n = 0; n < groups(); n++){
+        int base = g * Group::WIDTH;
+        Group group(&ctrl_[base]);
+
+        for (uint32_t match = group.match(fragment); match; match &= match - 1){
+            int i = base + lowest_bit(match);
+            if (slots_[i].first == key){
+                found = true;
+                return i;
+            }
+        }
+        uint32_t free = group.match_empty_or_deleted();
+        if (target < 0 && free){
+            target = base + lowest_bit(free);
         }
+        if (group.match_empty()){
+            break;
+        }
+        // Triangular probing visits every group of a power-of-two table
+        g = (g + n + 1) & group_mask();
+    }
+    if (ctrl_[target] == CTRL_EMPTY){
+        used_++;
+    }
+    ctrl_[target] = fragment;
+    return target;
+}
+
+/**
+ * Claims a slot in the current table for a pair that is known not to be
+ * in it, and marks it full. Returns its index.
+ */
+template <class Key, class Value>
+int HashMap<Key, Value>::insert_new(size_t hash){
+    int g = h1(hash) & group_mask();
+    uint32_t free;
+    for (int n = 1; !(free = Group(&ctrl_[g * Group::WIDTH]).match_empty_or_deleted()); n++){
+        g = (g + n) & group_mask();
+    }
+    int i = g * Group::WIDTH + lowest_bit(free);
+    if (ctrl_[i] == CTRL_EMPTY){
+        used_++;
+    }
+    ctrl_[i] = h2(hash);
+    return i;
+}
+
+/**
+ * Moves the pair in slot j of the old table into the current table.
+ */
+template <class Key, class Value>
+void HashMap<Key, Value>::migrate(int j){
+    int i = insert_new(mix_hash(hashcode(oldSlots_[j].first)));
+    new (&slots_[i]) Slot(std::move(oldSlots_[j]));
+    oldSlots_[j].~Slot();
+    oldCtrl_[j] = CTRL_DELETED;
+    oldLive_--;
+}
+
+/**
+ * If key is still waiting in the old table, moves it to the current one
+ * so that it can be updated or removed there.
+ */
+template <class Key, class Value>
+template <class K>
+void HashMap<Key, Value>::adopt(const K& key){
+    int j = find_old(key);
+    if (j >= 0){
+        migrate(j);
+    }
+}
+
+/**
+ * Moves the next group of the old table into the current table, and
+ * releases the old table once it has been drained.
+ */
+template <class Key, class Value>
+void HashMap<Key, Value>::migrate_step(){
+    int base = oldGroup_ * Group::WIDTH;
+    for (uint32_t full = Group(&oldCtrl_[base]).match_full(); full; full &= full - 1){
+        migrate(base + lowest_bit(full));
+    }
+    if (++oldGroup_ * Group::WIDTH == oldSize_){
+        alloc_.deallocate(oldSlots_, oldSize_);
+        oldSlots_ = nullptr;
+        std::vector<int8_t>().swap(oldCtrl_);
+        oldSize_ = oldLive_ = oldGroup_ = 0;
+    }
+}
+
+/**
+ * Drains whatever is left of an incremental resize in one go.
+ */
+template <class Key, class Value>
+void HashMap<Key, Value>::finish_migration(){
+    while (oldSlots_){
+        migrate_step();
+    }
+}
+
+/**
+ * Double the size of the probing table if the load factor (counting
+ * tombstones and anything still to be migrated) exceeds the max. If most
+ * of the load is tombstones the table is instead rehashed at its current
+ * size.
+ *
+ * Each insert drains a group, so an incremental resize finishes well
+ * before the new table fills up; if it has not, it is finished first.
+ */
+template <class Key, class Value>
+void HashMap<Key, Value>::grow(){
+    int limit = static_cast<int>(tableSize_ * maxLoad_);
+    if (used_ + oldLive_ + 1 <= limit){
+        return;
+    }
+    finish_migration();
+    if (used_ + 1 > limit){
+        if (size_ + 1 > limit / 2){
+            resize(tableSize_ * 2);
+        } else {
+            resize(tableSize_);
+        }
+    }
+}
+
+/**
+ * Inserts the key-value pair into the HashMap, or assigns value to the
+ * pair already there. Key and value are forwarded, so either is moved
+ * into place when passed as an rvalue.
+ */
+template <class Key, class Value>
+template <class K, class V>
+bool HashMap<Key, Value>::assign(K&& key, V&& value){
+    bool found;
+    int i = insert_slot(key, mix_hash(hashcode(key)), found);
+    if (found){
+        slots_[i].second = std::forward<V>(value);
+        return false;
     }
     // Otherwise empty slot
-    items_[i] = new Pair<Key, Value>();
-    items_[i]->first = key;
-    items_[i]->second = value;
+    new (&slots_[i]) Slot(InPlace(), std::forward<K>(key), std::forward<V>(value));
+    size_++;
+    return true;
+}
+
+/**
+ * Inserts a pair for key with its value constructed in place from args,
+ * unless key is already present, in which case nothing is constructed and
+ * args are left untouched.
+ */
+template <class Key, class Value>
+template <class K, class... Args>
+bool HashMap<Key, Value>::construct(K&& key, Args&&... args){
+    bool found;
+    int i = insert_slot(key, mix_hash(hashcode(key)), found);
+    if (found){
+        return false;
+    }
+    new (&slots_[i]) Slot(InPlace(), std::forward<K>(key), std::forward<Args>(args)...);
     size_++;
+    return true;
+}
+
+/**
+ * Constructs a pair from args as Pair<Key, Value>'s constructors would,
+ * and moves it into the HashMap unless its key is already present. The
+ * key has to exist before it can be hashed, so prefer try_emplace, which
+ * builds nothing for a key that is already there.
+ */
+template <class Key, class Value>
+template <class... Args>
+bool HashMap<Key, Value>::emplace(Args&&... args){
+    Slot pair(std::forward<Args>(args)...);
+    return construct(std::move(pair.first), std::move(pair.second));
 }
 
 /**
@@ -142,68 +624,214 @@ void HashMap<Key, Value>::put(Pair<const Key&, const Value&> pair){
     put(pair.first, pair.second);
 }
 
+/**
+ * Inserts every key-value pair in [first, last), reserving room for all of
+ * them up front when the length of the range is known. Keys are hashed a
+ * batch at a time and their first group prefetched before any is probed,
+ * so that the cache misses of a batch overlap.
+ */
+template <class Key, class Value>
+template <class Iter>
+void HashMap<Key, Value>::insert_bulk(Iter first, Iter last){
+    typedef typename std::iterator_traits<Iter>::iterator_category Category;
+    if (std::is_base_of<std::forward_iterator_tag, Category>::value){
+        reserve(size_ + static_cast<int>(std::distance(first, last)));
+    }
+
+    size_t hashes[BATCH];
+    while (first != last){
+        Iter start = first;
+        int n = 0;
+        for (; n < BATCH && first != last; n++, ++first){
+            hashes[n] = mix_hash(hashcode((*first).first));
+            prefetch(hashes[n]);
+        }
+        for (int k = 0; k < n; k++, ++start){
+            const Key& key = (*start).first;
+            bool found;
+            int i = insert_slot(key, hashes[k], found);
+            if (found){
+                slots_[i].second = (*start).second;
+            } else {
+                new (&slots_[i]) Slot(InPlace(), key, (*start).second);
+                size_++;
+            }
+        }
+    }
+}
+
+/**
+ * Issues prefetches for the control bytes and first slots of the group a
+ * probe for hash starts at.
+ */
+template <class Key, class Value>
+inline void HashMap<Key, Value>::prefetch(size_t hash) const {
+    if (!tableSize_){
+        return;
+    }
+    size_t base = (h1(hash) & group_mask()) * Group::WIDTH;
+    __builtin_prefetch(ctrl_.data() + base);
+    __builtin_prefetch(slots_ + base);
+}
+
 /** 
  * Returns a reference to the value in the HashMap at key.
  * Creates a new pair if not in the map.
  */
 template <class Key, class Value>
-Value& HashMap<Key, Value>::get(const Key& key){
-    int i = hashcode(key) % tableSize_;
-    for(; items_[i]; i = (i + 1) % tableSize_){
-        if (items_[i]->first == key){
-            return items_[i]->second;
-        }
+template <class K, class>
+Value& HashMap<Key, Value>::get(const K& key){
+    bool found;
+    int i = insert_slot(key, mix_hash(hashcode(key)), found);
+    if (!found){
+        // Create a new key-value pair and return reference
+        // to the value.
+        new (&slots_[i]) Slot(InPlace(), key);
+        size_++;
     }
-    // Create a new key-value pair and return reference
-    // to the value.
-    items_[i] = new Pair<Key, Value>();
-    items_[i]->first = key;
-    size_++;
+    return slots_[i].second;
+}
 
-    return items_[i]->second;
+template <class Key, class Value>
+Value& HashMap<Key, Value>::get(Key&& key){
+    bool found;
+    int i = insert_slot(key, mix_hash(hashcode(key)), found);
+    if (!found){
+        new (&slots_[i]) Slot(InPlace(), std::move(key));
+        size_++;
+    }
+    return slots_[i].second;
 }
 
 /**
- * Returns true if the key is contained in the HashMap.
+ * Returns a pointer to the value in the HashMap at key, or nullptr if the
+ * key is not present. Unlike get, never inserts.
  */
 template <class Key, class Value>
-bool HashMap<Key, Value>::contains(const Key& key) const {
-    for(int i = hashcode(key) % tableSize_; items_[i]; i = (i + 1) % tableSize_){
-        if (items_[i]->first == key){
-            return true;
+template <class K, class>
+Value* HashMap<Key, Value>::find(const K& key){
+    const HashMap<Key, Value>* self = this;
+    return const_cast<Value*>(self->find(key));
+}
+
+template <class Key, class Value>
+template <class K, class>
+const Value* HashMap<Key, Value>::find(const K& key) const {
+    int i = find_index(key);
+    if (i >= 0){
+        return &slots_[i].second;
+    }
+    int j = find_old(key);
+    return j < 0 ? nullptr : &oldSlots_[j].second;
+}
+
+/**
+ * Looks up n keys at once, storing a pointer to each value (or nullptr if
+ * the key is not present) in out. Returns the number of keys found.
+ *
+ * A batch of keys moves through the lookup in stages: all are hashed and
+ * their control bytes prefetched, then all are matched and their candidate
+ * slots prefetched, then all are compared. The cache misses of a batch
+ * overlap instead of being taken one at a time. This pays off once the
+ * table no longer fits in cache; for small tables find is cheaper.
+ */
+template <class Key, class Value>
+size_t HashMap<Key, Value>::find_batch(const Key* keys, size_t n, const Value** out) const {
+    if (!tableSize_){
+        // Moved from, so there is not even a table to probe
+        std::fill(out, out + n, nullptr);
+        return 0;
+    }
+
+    size_t hashes[BATCH];
+    uint32_t matches[BATCH];
+    size_t found = 0;
+    for (size_t start = 0; start < n; start += BATCH){
+        size_t count = std::min(n - start, static_cast<size_t>(BATCH));
+
+        // Hash every key and prefetch its first group of control bytes
+        for (size_t k = 0; k < count; k++){
+            hashes[k] = mix_hash(hashcode(keys[start + k]));
+            __builtin_prefetch(&ctrl_[(h1(hashes[k]) & group_mask()) * Group::WIDTH]);
+        }
+        // Match fragments in the first group and prefetch the first
+        // candidate slot
+        for (size_t k = 0; k < count; k++){
+            size_t base = (h1(hashes[k]) & group_mask()) * Group::WIDTH;
+            matches[k] = Group(&ctrl_[base]).match(h2(hashes[k]));
+            if (matches[k]){
+                __builtin_prefetch(&slots_[base + lowest_bit(matches[k])]);
+            }
+        }
+        // Compare keys, falling back to a full probe for the rare key that
+        // is not in its first group
+        for (size_t k = 0; k < count; k++){
+            const Key& key = keys[start + k];
+            const Value* value = nullptr;
+
+            size_t base = (h1(hashes[k]) & group_mask()) * Group::WIDTH;
+            int i = -1;
+            for (uint32_t match = matches[k]; match; match &= match - 1){
+                if (slots_[base + lowest_bit(match)].first == key){
+                    i = base + lowest_bit(match);
+                    break;
+                }
+            }
+            if (i < 0 && !Group(&ctrl_[base]).match_empty()){
+                i = probe(slots_, ctrl_.data(), tableSize_, key, hashes[k]);
+            }
+            if (i >= 0){
+                value = &slots_[i].second;
+            } else if (oldSlots_){
+                int j = probe(oldSlots_, oldCtrl_.data(), oldSize_, key, hashes[k]);
+                if (j >= 0){
+                    value = &oldSlots_[j].second;
+                }
+            }
+            out[start + k] = value;
+            found += value != nullptr;
         }
     }
-    return false;
+    return found;
+}
+
+/**
+ * Returns true if the key is contained in the HashMap.
+ */
+template <class Key, class Value>
+template <class K, class>
+bool HashMap<Key, Value>::contains(const K& key) const {
+    return find_index(key) >= 0 || find_old(key) >= 0;
 }
 
 /*
- * Removes a key-value pair from the HashMap. May possibly trigger a rehash.
+ * Removes a key-value pair from the HashMap. If the slot's group still has
+ * an empty slot, no probe sequence has ever continued past it and the slot
+ * can be emptied outright. Otherwise it is marked with a tombstone so that
+ * probe sequences passing through it remain intact; tombstones are
+ * reclaimed by the next resize.
  */
 template <class Key, class Value>
-void HashMap<Key, Value>::remove(const Key& key) {
-    // Search for item and delete it.
-    if (!contains(key)){
-        return;
+template <class K, class>
+void HashMap<Key, Value>::remove(const K& key) {
+    if (oldSlots_){
+        migrate_step();
+        adopt(key);
     }
-    int i = hashcode(key);
-    while (items_[i]->first != key){
-        i = (i + 1) % tableSize_;
-    }
-    // Removal
-    delete items_[i];
-    items_[i] = nullptr;
-    // Rehashing
-    while (items_[i]){
-        auto redoItem = items_[i];
-        items_[i] = nullptr;
-        size_--;
-        put(redoItem[i]->first, redoItem[i]->second);
-        i = (i + 1) % tableSize_;
-        delete redoItem;
+    int i = find_index(key);
+    if (i < 0){
+        return;
     }
+    slots_[i].~Slot();
     size_--;
-    // Possibly add a trigger to a rehash to a smaller table
-    return;
+
+    Group group(&ctrl_[i / Group::WIDTH * Group::WIDTH]);
+    if (group.match_empty()){
+        ctrl_[i] = CTRL_EMPTY;
+        used_--;
+    } else {
+        ctrl_[i] = CTRL_DELETED;
+    }
 }
 
 template <class Key, class Value>
@@ -211,32 +839,49 @@ inline size_t HashMap<Key, Value>::size() const {
     return size_;
 }
 
+/**
+ * Returns the number of pairs the HashMap can hold before an insert
+ * rehashes the table. Tombstones count against it.
+ */
+template <class Key, class Value>
+inline int HashMap<Key, Value>::capacity() const {
+    return static_cast<int>(tableSize_ * maxLoad_) - (used_ + oldLive_ - size_);
+}
+
+/**
+ * Grows the table so that it holds at least n pairs before the next
+ * rehash.
+ */
+template <class Key, class Value>
+void HashMap<Key, Value>::reserve(int n){
+    if (n > capacity()){
+        resize(static_cast<int>(n / maxLoad_) + 1);
+    }
+}
+
 /** 
  * Resizes the HashMap and rehashes all of the key-value pairs into new
- * locations.
+ * locations, dropping any tombstones. With incremental resizing the old
+ * table is only set aside here, to be drained by later operations.
  */
 template <class Key, class Value>
 void HashMap<Key, Value>::resize(int newSize){
-    std::vector<Pair<Key, Value>*> old = items_;
+    // Only one table can be draining at a time
+    finish_migration();
 
-    // Reset
-    items_.resize(newSize);
-    for (int i = 0; i < newSize; i++){
-        items_[i] = nullptr;
-    }
+    oldSlots_ = slots_;
+    oldCtrl_.assign(table_capacity(newSize), CTRL_EMPTY);
+    oldCtrl_.swap(ctrl_);
+    oldSize_ = tableSize_;
+    oldLive_ = size_;
 
-    // Rehash
-    for (int i = 0; i < tableSize_; i++){
-        if (old[i]){
-            int i = hashcode(old[i]->first) % tableSize_;
-            while(items_[i]){
-                i = (i + 1) % tableSize_;
-            }
-            items_[i] = old[i];
-        }
-    }
+    tableSize_ = table_capacity(newSize);
+    slots_ = alloc_.allocate(tableSize_);
+    used_ = 0;
 
-    tableSize_ = newSize;
+    if (!incremental_){
+        finish_migration();
+    }
 };
 
 template <class Key, class Value>
@@ -246,7 +891,7 @@ typename HashMap<Key, Value>::Iterator HashMap<Key, Value>::begin() const {
 
 template <class Key, class Value>
 typename HashMap<Key, Value>::Iterator HashMap<Key, Value>::end() const {
-    Iterator iter(this, tableSize_);
+    Iterator iter(this, oldSize_ + tableSize_);
 
     return iter;
 }
@@ -255,6 +900,9 @@ typename HashMap<Key, Value>::Iterator HashMap<Key, Value>::end() const {
  * An iterator class for accessing the elements
  * of the HashMap in no particular order.
  *
+ * While an incremental resize is in progress the counter runs through the
+ * old table and then the current one.
+ *
  * It is the responsibility of the client to no longer use an iterator
  * after the map has been altered or destroyed.
  *
@@ -264,13 +912,17 @@ typename HashMap<Key, Value>::Iterator HashMap<Key, Value>::end() const {
 template <class Key, class Value>
 class HashMap<Key, Value>::Iterator {
 public:
+    // Dereferencing yields a Pair of references rather than a reference,
+    // so this can only be an input iterator
+    typedef std::input_iterator_tag iterator_category;
+    typedef Pair<const Key&, Value&> value_type;
+    typedef Pair<const Key&, Value&> reference;
+    typedef void pointer;
+    typedef std::ptrdiff_t difference_type;
+
     Iterator(const HashMap<Key, Value>* map, int counter) : map_(map), counter_(counter) {
-        if (map_->size_ > 0){
-            // Find the first non-null element in the table
-            while (!map_->items_[counter_]){
-                counter_++;
-            }
-        }
+        // Find the first full slot in the table
+        skip();
     }
 
     Iterator& operator++(){
@@ -289,26 +941,41 @@ public:
         return other.map_ != map_ || other.counter_ != counter_;
     }
     Pair<const Key&, Value&> operator*(){
-        auto iter = map_->items_[counter_];
-        return Pair<const Key&, Value&>(iter->first, iter->second);
+        size_t oldSize = map_->oldSize_;
+        auto& slot = counter_ < oldSize ? map_->oldSlots_[counter_] : map_->slots_[counter_ - oldSize];
+        return Pair<const Key&, Value&>(slot.first, slot.second);
     }
 private:
     const HashMap<Key, Value>* map_;
     size_t counter_ = 0;
 
+    bool full() const {
+        size_t oldSize = map_->oldSize_;
+        if (counter_ < oldSize){
+            return map_->oldCtrl_[counter_] >= 0;
+        }
+        return map_->full(counter_ - oldSize);
+    }
+
+    /**
+     * Advances the counter until we have a full slot
+     * or reach the end.
+     */
+    void skip(){
+        size_t end = map_->oldSize_ + map_->tableSize_;
+        while (counter_ < end && !full()){
+            counter_++;
+        }
+    }
+
     /** 
      * Guarantees the counter moves at least once,
-     * then continues until we have a non-null element
+     * then continues until we have a full slot
      * or reach the end.
      */
     void increment(){
         counter_++;
-        while (counter_ < map_->tableSize_ && !map_->items_[counter_]){
-            counter_++;
-        }
-        if (counter_ > map_->tableSize_){
-            counter_ = map_->tableSize_;
-        }
+        skip();
     }
 };
 
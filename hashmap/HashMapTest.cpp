@@ -1,38 +1,317 @@
+#define BOOST_TEST_MODULE HashMap test
 #include <iostream>
+#include <memory>
 #include <string>
+#include <vector>
+
+#include <boost/test/unit_test.hpp>
 
 #include "HashMap.h"
 
-#include <boost/test/unit_test.hpp>
+void populate_map(HashMap<std::string, int>& map){
+    std::vector<std::string> keys = {"Doggy", "Cat", "Frog", "Monkey"};
+    std::vector<int> values = {15, 10, 20, -10};
+
+    for (size_t i = 0; i < values.size(); i++){
+        map.put(keys[i], values[i]);
+    }
+}
 
 BOOST_AUTO_TEST_CASE(ctor_test){
+    HashMap<std::string, int> map = { {"Doggy", 15}, {"Cat", 10}, {"Frog", 20} };
+
+    BOOST_CHECK_EQUAL(map.size(), 3);
+    BOOST_CHECK_EQUAL(map.get("Cat"), 10);
+
+    HashMap<std::string, int> copy(map);
+    copy.put("Cat", 11);
+
+    BOOST_CHECK_EQUAL(copy.size(), 3);
+    BOOST_CHECK_EQUAL(copy.get("Cat"), 11);
+    BOOST_CHECK_EQUAL(map.get("Cat"), 10);
 }
 
 BOOST_AUTO_TEST_CASE(size_test){
+    HashMap<std::string, int> map;
+    BOOST_CHECK_EQUAL(map.size(), 0);
+
+    populate_map(map);
+    BOOST_CHECK_EQUAL(map.size(), 4);
 }
 
 BOOST_AUTO_TEST_CASE(iteration_test){
+    HashMap<int, int> map;
+    BOOST_CHECK(map.begin() == map.end());
+
+    const int TEST_SIZE = 100;
+    for (int i = 0; i < TEST_SIZE; i++){
+        map.put(i, i * i);
+    }
+
+    std::vector<bool> seen(TEST_SIZE, false);
+    int count = 0;
+    for (auto iter = map.begin(); iter != map.end(); iter++){
+        auto pair = *iter;
+        BOOST_CHECK_EQUAL(pair.second, pair.first * pair.first);
+        BOOST_CHECK(!seen[pair.first]);
+        seen[pair.first] = true;
+        count++;
+    }
+    BOOST_CHECK_EQUAL(count, TEST_SIZE);
 }
 
 BOOST_AUTO_TEST_CASE(contains_test){
+    HashMap<std::string, int> map;
+
+    populate_map(map);
+
+    BOOST_CHECK(map.contains("Doggy"));
+    BOOST_CHECK(map.contains("Monkey"));
+    BOOST_CHECK(!map.contains("Giraffe"));
+    BOOST_CHECK_EQUAL(map["Frog"], 20);
 }
 
 BOOST_AUTO_TEST_CASE(duplicate_test){
+    HashMap<std::string, int> map;
+
+    populate_map(map);
+    map.put("Cat", 42);
+
+    BOOST_CHECK_EQUAL(map.size(), 4);
+    BOOST_CHECK_EQUAL(map.get("Cat"), 42);
+}
+
+BOOST_AUTO_TEST_CASE(remove_test){
+    HashMap<int, int> map;
+
+    const int TEST_SIZE = 200;
+    for (int i = 0; i < TEST_SIZE; i++){
+        map.put(i, i);
+    }
+    for (int i = 0; i < TEST_SIZE; i += 2){
+        map.remove(i);
+    }
+    map.remove(TEST_SIZE);
+
+    BOOST_CHECK_EQUAL(map.size(), TEST_SIZE / 2);
+    for (int i = 0; i < TEST_SIZE; i++){
+        BOOST_CHECK_EQUAL(map.contains(i), i % 2 == 1);
+    }
+
+    // Reinsert over the tombstones
+    for (int i = 0; i < TEST_SIZE; i += 2){
+        map.put(i, -i);
+    }
+    BOOST_CHECK_EQUAL(map.size(), TEST_SIZE);
+    BOOST_CHECK_EQUAL(map.get(10), -10);
+}
+
+BOOST_AUTO_TEST_CASE(copy_after_remove_test){
+    // A full table leaves probe sequences running through groups that
+    // only hold tombstones after the removals; copies must still find
+    // every key past them
+    const int TEST_SIZE = 100000;
+
+    HashMap<int, int> map;
+    map.set_max_load(0.875);
+    for (int i = 0; i < TEST_SIZE; i++){
+        map.put(i, i);
+    }
+    for (int i = 0; i < TEST_SIZE; i += 3){
+        map.remove(i);
+    }
+
+    HashMap<int, int> copy(map);
+    HashMap<int, int> assigned;
+    assigned = map;
+    int missing = 0;
+    for (int i = 0; i < TEST_SIZE; i++){
+        bool expected = i % 3 != 0;
+        missing += map.contains(i) != expected;
+        missing += copy.contains(i) != expected;
+        missing += assigned.contains(i) != expected;
+    }
+    BOOST_CHECK_EQUAL(missing, 0);
+    BOOST_CHECK_EQUAL(copy.size(), map.size());
+    BOOST_REQUIRE(copy.find(TEST_SIZE - 2));
+    BOOST_CHECK_EQUAL(*copy.find(TEST_SIZE - 2), TEST_SIZE - 2);
+
+    // The copy has no tombstones left to count against its load
+    for (int i = 0; i < TEST_SIZE; i += 3){
+        copy.put(i, -i);
+    }
+    BOOST_CHECK_EQUAL(copy.size(), TEST_SIZE);
+    BOOST_CHECK_EQUAL(copy.get(3), -3);
 }
 
 BOOST_AUTO_TEST_CASE(clear_test){
 }
 
 BOOST_AUTO_TEST_CASE(rehash_test){
+    HashMap<std::string, int> map;
+
+    const int TEST_SIZE = 1000;
+    for (int i = 0; i < TEST_SIZE; i++){
+        map.put("key" + std::to_string(i), i);
+    }
+
+    BOOST_CHECK_EQUAL(map.size(), TEST_SIZE);
+    for (int i = 0; i < TEST_SIZE; i++){
+        BOOST_CHECK_EQUAL(map.get("key" + std::to_string(i)), i);
+    }
 }
 
-int main(int argc, const char *argv[])
-{
-    HashMap<std::string, int> map = { {"Doggy", 15}, {"Cat", 10}, {"Frog", 20} };
+BOOST_AUTO_TEST_CASE(heterogeneous_lookup_test){
+    HashMap<std::string, int> map;
+    populate_map(map);
+
+    const char* frog = "Frog";
+    BOOST_CHECK(map.contains(frog));
+    BOOST_CHECK_EQUAL(*map.find(frog), 20);
+    BOOST_CHECK(!map.find("Giraffe"));
+
+#if __cplusplus >= 201703L
+    std::string buffer = "key=Monkey;";
+    std::string_view monkey(buffer.data() + 4, 6);
+    BOOST_CHECK_EQUAL(map.get(monkey), -10);
+
+    map.get(std::string_view(buffer.data(), 3)) = 7;
+    BOOST_CHECK_EQUAL(map.get("key"), 7);
+
+    map.remove(monkey);
+    BOOST_CHECK(!map.contains("Monkey"));
+#endif
+}
+
+BOOST_AUTO_TEST_CASE(bulk_test){
+    const int TEST_SIZE = 1000;
+
+    std::vector<Pair<int, int> > pairs;
+    for (int i = 0; i < TEST_SIZE; i++){
+        pairs.push_back(create_pair(i, 3 * i));
+    }
+
+    HashMap<int, int> map;
+    map.put(0, -1);
+    map.insert_bulk(pairs);
+    BOOST_CHECK_EQUAL(map.size(), TEST_SIZE);
+
+    // Every other key present, with a miss in between
+    std::vector<int> keys;
+    for (int i = 0; i < 2 * TEST_SIZE; i += 2){
+        keys.push_back(i);
+    }
+    std::vector<const int*> values(keys.size());
+    size_t found = map.find_batch(keys.data(), keys.size(), values.data());
+
+    BOOST_CHECK_EQUAL(found, TEST_SIZE / 2);
+    for (size_t k = 0; k < keys.size(); k++){
+        if (keys[k] < TEST_SIZE){
+            BOOST_REQUIRE(values[k]);
+            BOOST_CHECK_EQUAL(*values[k], 3 * keys[k]);
+        } else {
+            BOOST_CHECK(!values[k]);
+        }
+    }
+}
+
+BOOST_AUTO_TEST_CASE(incremental_rehash_test){
+    HashMap<int, int> map;
+    map.set_incremental_resize(true);
+
+    // Keys are removed 100 inserts after they were added, so that removals
+    // land in both the old and the current table
+    const int TEST_SIZE = 5000;
+    const int LAG = 100;
+    bool sawResize = false;
+    for (int i = 0; i < TEST_SIZE; i++){
+        map.put(i, i);
+        if (map.resizing()){
+            sawResize = true;
 
+            // Everything must stay visible while the old table drains
+            BOOST_CHECK(map.contains(i));
+            if (i >= LAG / 2){
+                BOOST_CHECK(map.find(i - LAG / 2));
+            }
+        }
+        if (i % 4 == 0 && i >= LAG){
+            map.remove(i - LAG);
+        }
+    }
+    BOOST_CHECK(sawResize);
+
+    int count = 0;
     for (auto iter = map.begin(); iter != map.end(); iter++){
-        std::cout << (*iter).second << std::endl;
+        count++;
+    }
+    BOOST_CHECK_EQUAL(count, map.size());
+
+    HashMap<int, int> copy(map);
+    BOOST_CHECK(!copy.resizing());
+    BOOST_CHECK_EQUAL(copy.size(), map.size());
+
+    for (int i = 0; i < TEST_SIZE; i++){
+        bool removed = i % 4 == 0 && i < TEST_SIZE - LAG;
+        BOOST_CHECK_EQUAL(map.contains(i), !removed);
+        BOOST_CHECK_EQUAL(copy.contains(i), !removed);
     }
+}
+
+BOOST_AUTO_TEST_CASE(move_test){
+    HashMap<std::string, int> map;
+    populate_map(map);
+
+    HashMap<std::string, int> moved(std::move(map));
+    BOOST_CHECK_EQUAL(moved.size(), 4);
+    BOOST_CHECK_EQUAL(moved.get("Cat"), 10);
 
-    return 0;
+    // A moved-from map is empty, but still usable
+    BOOST_CHECK_EQUAL(map.size(), 0);
+    BOOST_CHECK(!map.contains("Cat"));
+    BOOST_CHECK(map.begin() == map.end());
+    map.put("Giraffe", 1);
+    BOOST_CHECK_EQUAL(map.get("Giraffe"), 1);
+
+    map = std::move(moved);
+    BOOST_CHECK_EQUAL(map.size(), 4);
+    BOOST_CHECK(!map.contains("Giraffe"));
+}
+
+BOOST_AUTO_TEST_CASE(emplace_test){
+    // Values that can only be moved never get copied on the way in
+    HashMap<std::string, std::unique_ptr<int> > map;
+
+    BOOST_CHECK(map.try_emplace("a", new int(1)));
+    BOOST_CHECK(!map.try_emplace("a", std::unique_ptr<int>(new int(2))));
+    BOOST_CHECK_EQUAL(*map.get("a"), 1);
+
+    // try_emplace leaves its arguments alone if the key is present
+    std::unique_ptr<int> value(new int(3));
+    BOOST_CHECK(!map.try_emplace("a", std::move(value)));
+    BOOST_REQUIRE(value);
+
+    BOOST_CHECK(map.insert_or_assign("b", std::move(value)));
+    BOOST_CHECK(!value);
+    BOOST_CHECK(!map.insert_or_assign("b", std::unique_ptr<int>(new int(4))));
+    BOOST_CHECK_EQUAL(*map.get("b"), 4);
+
+    BOOST_CHECK(map.emplace(std::string("c"), std::unique_ptr<int>(new int(5))));
+    BOOST_CHECK(!map.emplace(std::string("c"), std::unique_ptr<int>()));
+    BOOST_CHECK_EQUAL(*map.get("c"), 5);
+
+    std::string key = "d";
+    map[std::move(key)].reset(new int(6));
+    BOOST_CHECK_EQUAL(*map.get("d"), 6);
+
+    // Rehashing moves every pair
+    const int TEST_SIZE = 1000;
+    for (int i = 0; i < TEST_SIZE; i++){
+        map.put(std::to_string(i), std::unique_ptr<int>(new int(i)));
+    }
+    HashMap<std::string, std::unique_ptr<int> > moved(std::move(map));
+    BOOST_CHECK_EQUAL(moved.size(), TEST_SIZE + 4);
+    for (int i = 0; i < TEST_SIZE; i++){
+        BOOST_CHECK_EQUAL(*moved.get(std::to_string(i)), i);
+    }
 }
@@ -21,29 +21,87 @@
  */
 
 #ifndef HASH_SET_H_
-#define HASH_SET_H
+#define HASH_SET_H_
 
 #include <vector>
 #include <string>
 #include <functional>
+#include <memory>
+#include <new>
+#include <utility>
+#include <type_traits>
 
 #include <initializer_list>
+#include <iterator>
 
 #include "Hash.h"
+#include "Group.h"
+#include "ThreadPool.h"
+
+template <class Key>
+class HashSet;
+
+template <class Key>
+HashSet<Key> set_union(const HashSet<Key>& a, const HashSet<Key>& b, ThreadPool& pool = ThreadPool::shared());
+template <class Key>
+HashSet<Key> set_intersection(const HashSet<Key>& a, const HashSet<Key>& b, ThreadPool& pool = ThreadPool::shared());
+template <class Key>
+HashSet<Key> set_difference(const HashSet<Key>& a, const HashSet<Key>& b, ThreadPool& pool = ThreadPool::shared());
 
 /**
- * HashSet container class implemented with linear probing
+ * HashSet container class implemented with group probing.
+ *
+ * Keys are stored inline in a single contiguous slot array, alongside a
+ * parallel array of control bytes (see Group.h).
  */
 template <class Key>
 class HashSet {
+    template <class K>
+    using Lookup = typename std::enable_if<std::is_same<K, Key>::value || is_transparent<Hash<Key> >::value>::type;
+    template <class Iter>
+    using RandomAccess = typename std::enable_if<std::is_base_of<std::random_access_iterator_tag,
+            typename std::iterator_traits<Iter>::iterator_category>::value>::type;
 public:
     HashSet();
     HashSet(std::initializer_list<const Key> list);
+    template <class Iter, class = RandomAccess<Iter> >
+    HashSet(Iter first, Iter last, ThreadPool& pool = ThreadPool::shared()) : HashSet() {
+        insert_bulk(first, last, pool);
+    }
+    HashSet(const HashSet<Key>& other);
+    HashSet(HashSet<Key>&& other) noexcept;
+    HashSet<Key>& operator=(const HashSet<Key>& other);
+    HashSet<Key>& operator=(HashSet<Key>&& other) noexcept;
     ~HashSet();
 
-    void put(const Key& key);
-    void remove(const Key& key);
-    bool contains(const Key& key) const;
+    void put(const Key& key){
+        insert(key);
+    }
+    void put(Key&& key){
+        insert(std::move(key));
+    }
+    template <class... Args>
+    bool emplace(Args&&... args);
+    template <class Iter, class = RandomAccess<Iter> >
+    void insert_bulk(Iter first, Iter last, ThreadPool& pool = ThreadPool::shared()){
+        put_parallel(last - first, [&](size_t i) -> const Key& { return first[i]; }, pool);
+    }
+    void remove(const Key& key){
+        remove<Key>(key);
+    }
+    bool contains(const Key& key) const {
+        return contains<Key>(key);
+    }
+
+    // Lookups by any type Hash<Key> is transparent for, without
+    // constructing a Key unless it is inserted (see is_transparent in
+    // Hash.h)
+    template <class K, class = Lookup<K> >
+    void put(const K& key);
+    template <class K, class = Lookup<K> >
+    void remove(const K& key);
+    template <class K, class = Lookup<K> >
+    bool contains(const K& key) const;
 
     float max_load() const {
         return maxLoad_;
@@ -52,23 +110,62 @@ public:
         maxLoad_ = maxLoad;
     }
     size_t size() const;
+    void reserve(int n);
 
     class Iterator;
     Iterator begin() const;
     Iterator end() const;
 private:
+    template <class K>
+    friend HashSet<K> set_union(const HashSet<K>&, const HashSet<K>&, ThreadPool&);
+    template <class K>
+    friend HashSet<K> set_intersection(const HashSet<K>&, const HashSet<K>&, ThreadPool&);
+    template <class K>
+    friend HashSet<K> set_difference(const HashSet<K>&, const HashSet<K>&, ThreadPool&);
+
+    // Inserts of fewer keys than this are not worth handing to a pool
+    static const size_t PARALLEL_MIN = 1 << 14;
+    // Most regions a parallel insert splits the table into. Each is a run
+    // of groups that only one thread writes to
+    static const int PARTITIONS = 128;
+
     int size_ = 0; // Number of items
-    int tableSize_ = 41; // size of linear-probing table
+    int used_ = 0; // Number of slots that are not empty, including tombstones
+    int tableSize_ = table_capacity(41); // size of probing table
 
     float maxLoad_ = 0.25;
     void resize(int newSize);
-    
+    void grow();
+    template <class K>
+    int find(const K& key) const;
+    template <class K>
+    bool insert(K&& key);
+    template <class KeyAt>
+    void put_parallel(size_t n, KeyAt key, ThreadPool& pool);
+    int claim(const Key& key, size_t hash, int shift, size_t region);
+    template <class Keep>
+    std::vector<const Key*> gather(Keep keep, ThreadPool& pool) const;
+    void destroy();
+    void steal(HashSet<Key>& other);
+
+    bool full(int i) const {
+        return ctrl_[i] >= 0;
+    }
+    int groups() const {
+        return tableSize_ / Group::WIDTH;
+    }
+    size_t group_mask() const {
+        return groups() - 1;
+    }
+
     Hash<Key> hashcode;
-    std::vector<Key*> items_;
+    std::allocator<Key> alloc_;
+    Key* slots_ = nullptr; // Uninitialized except where the slot is full
+    std::vector<int8_t> ctrl_;
 };
 
 template <class Key>
-HashSet<Key>::HashSet() : items_(tableSize_, nullptr) {}
+HashSet<Key>::HashSet() : slots_(alloc_.allocate(tableSize_)), ctrl_(tableSize_, CTRL_EMPTY) {}
 
 template <class Key>
 HashSet<Key>::HashSet(std::initializer_list<const Key> list) : HashSet() {
@@ -77,80 +174,240 @@ HashSet<Key>::HashSet(std::initializer_list<const Key> list) : HashSet() {
     }
 }
 
+template <class Key>
+HashSet<Key>::HashSet(const HashSet<Key>& other) :
+    size_(other.size_),
+    used_(other.size_),
+    tableSize_(other.tableSize_),
+    maxLoad_(other.maxLoad_),
+    hashcode(other.hashcode),
+    slots_(alloc_.allocate(other.tableSize_)),
+    ctrl_(other.tableSize_, CTRL_EMPTY)
+{
+    // Every key is rehashed into a table without tombstones. Keys cannot
+    // keep their slots, since a tombstone turned empty would cut short the
+    // probes that pass it.
+    for (int j = 0; j < tableSize_; j++){
+        if (other.full(j)){
+            size_t hash = mix_hash(hashcode(other.slots_[j]));
+            int g = h1(hash) & group_mask();
+            uint32_t free;
+            for (int n = 1; !(free = Group(&ctrl_[g * Group::WIDTH]).match_empty()); n++){
+                g = (g + n) & group_mask();
+            }
+            int i = g * Group::WIDTH + lowest_bit(free);
+
+            new (&slots_[i]) Key(other.slots_[j]);
+            ctrl_[i] = h2(hash);
+        }
+    }
+}
+
+template <class Key>
+HashSet<Key>::HashSet(HashSet<Key>&& other) noexcept {
+    steal(other);
+}
+
+template <class Key>
+HashSet<Key>& HashSet<Key>::operator=(const HashSet<Key>& other){
+    if (this != &other){
+        HashSet<Key> copy(other);
+        destroy();
+        steal(copy);
+    }
+    return *this;
+}
+
+template <class Key>
+HashSet<Key>& HashSet<Key>::operator=(HashSet<Key>&& other) noexcept {
+    if (this != &other){
+        destroy();
+        steal(other);
+    }
+    return *this;
+}
+
+/**
+ * Takes over the table of other, which is left empty and without a table
+ * at all; its first put allocates one. Anything this set owned must
+ * already have been released.
+ */
+template <class Key>
+void HashSet<Key>::steal(HashSet<Key>& other){
+    size_ = other.size_;
+    used_ = other.used_;
+    tableSize_ = other.tableSize_;
+    maxLoad_ = other.maxLoad_;
+    hashcode = other.hashcode;
+    slots_ = other.slots_;
+    ctrl_ = std::move(other.ctrl_);
+
+    other.size_ = other.used_ = other.tableSize_ = 0;
+    other.slots_ = nullptr;
+    other.ctrl_.clear();
+}
+
 template <class Key>
 HashSet<Key>::~HashSet(){
+    destroy();
+}
+
+/**
+ * Destroys every stored key and releases the slot array.
+ */
+template <class Key>
+void HashSet<Key>::destroy(){
     for (int i = 0; i < tableSize_; i++){
-        if (items_[i]){
-            delete items_[i];
+        if (full(i)){
+            slots_[i].~Key();
         }
     }
+    if (slots_){
+        alloc_.deallocate(slots_, tableSize_);
+    }
+    slots_ = nullptr;
 }
 
 /**
- * Inserts the key-value pair into the HashSet.
+ * Returns the index of the slot holding key, or -1 if it is not present.
  */
 template <class Key>
-void HashSet<Key>::put(const Key& key){
-    // Double the size of the linear-probing table if
-    // the load factor exceeds the max
-    if (size_ >= static_cast<int>(tableSize_ * maxLoad_)){
-        resize(tableSize_ * 2);
+template <class K>
+int HashSet<Key>::find(const K& key) const {
+    size_t hash = mix_hash(hashcode(key));
+    int8_t fragment = h2(hash);
+    int g = h1(hash) & group_mask();
+
+    for (int n = 0; n < groups(); n++){
+        int base = g * Group::WIDTH;
+        Group group(&ctrl_[base]);
+
+        for (uint32_t match = group.match(fragment); match; match &= match - 1){
+            int i = base + lowest_bit(match);
+            if (slots_[i] == key){
+                return i;
+            }
+        }
+        // An empty slot ends every probe sequence that reached this group
+        if (group.match_empty()){
+            return -1;
+        }
+        // Triangular probing visits every group of a power-of-two table
+        g = (g + n + 1) & group_mask();
     }
+    return -1;
+}
 
-    // Compute starting point of probe
-    int i = hashcode(key) % tableSize_;
-    // Probe for empty slot
-    for(; items_[i]; i = (i + 1) % tableSize_){
-        if (*items_[i] == key){
-            return;
+/**
+ * Double the size of the probing table if the load factor (counting
+ * tombstones) exceeds the max. If most of the load is tombstones the
+ * table is instead rehashed in place at its current size.
+ */
+template <class Key>
+void HashSet<Key>::grow(){
+    if (used_ + 1 > static_cast<int>(tableSize_ * maxLoad_)){
+        if (size_ + 1 > static_cast<int>(tableSize_ * maxLoad_ / 2)){
+            resize(tableSize_ * 2);
+        } else {
+            resize(tableSize_);
         }
     }
-    // Otherwise empty slot
-    items_[i] = new Key(key);
-    size_++;
 }
 
 /**
- * Returns true if the key is contained in the HashSet.
+ * Inserts the key into the HashSet.
  */
 template <class Key>
-bool HashSet<Key>::contains(const Key& key) const {
-    for(int i = hashcode(key) % tableSize_; items_[i]; i = (i + 1) % tableSize_){
-        if (*items_[i] == key){
-            return true;
+template <class K, class>
+void HashSet<Key>::put(const K& key){
+    insert(key);
+}
+
+/**
+ * Constructs a key from args and moves it into the HashSet, unless an
+ * equal key is already present. Returns true if it was inserted.
+ */
+template <class Key>
+template <class... Args>
+bool HashSet<Key>::emplace(Args&&... args){
+    Key key(std::forward<Args>(args)...);
+    return insert(std::move(key));
+}
+
+/**
+ * Constructs a Key from key, forwarding it so that an rvalue is moved
+ * into the slot, unless an equal key is already present. Returns true if
+ * it was inserted.
+ */
+template <class Key>
+template <class K>
+bool HashSet<Key>::insert(K&& key){
+    grow();
+
+    size_t hash = mix_hash(hashcode(key));
+    int8_t fragment = h2(hash);
+    int g = h1(hash) & group_mask();
+    int target = -1;
+
+    for (int n = 0; n < groups(); n++){
+        int base = g * Group::WIDTH;
+        Group group(&ctrl_[base]);
+
+        for (uint32_t match = group.match(fragment); match; match &= match - 1){
+            if (slots_[base + lowest_bit(match)] == key){
+                return false;
+            }
         }
+        uint32_t free = group.match_empty_or_deleted();
+        if (target < 0 && free){
+            target = base + lowest_bit(free);
+        }
+        if (group.match_empty()){
+            break;
+        }
+        // Triangular probing visits every group of a power-of-two table
+        g = (g + n + 1) & group_mask();
+    }
+    // Otherwise the first free slot along the probe sequence
+    if (ctrl_[target] == CTRL_EMPTY){
+        used_++;
     }
-    return false;
+    new (&slots_[target]) Key(std::forward<K>(key));
+    ctrl_[target] = fragment;
+    size_++;
+    return true;
+}
+
+/**
+ * Returns true if the key is contained in the HashSet.
+ */
+template <class Key>
+template <class K, class>
+bool HashSet<Key>::contains(const K& key) const {
+    return find(key) >= 0;
 }
 
 /*
- * Removes a key from the HashSet. May possibly trigger a rehash.
+ * Removes a key from the HashSet, leaving a tombstone only if some probe
+ * sequence may have continued past its group.
  */
 template <class Key>
-void HashSet<Key>::remove(const Key& key) {
-    // Search for item and delete it.
-    if (!contains(key)){
+template <class K, class>
+void HashSet<Key>::remove(const K& key) {
+    int i = find(key);
+    if (i < 0){
         return;
     }
-    int i = hashcode(key);
-    while (items_[i]->first != key){
-        i = (i + 1) % tableSize_;
-    }
-    // Removal
-    delete items_[i];
-    items_[i] = nullptr;
-    // Rehashing
-    while (items_[i]){
-        auto redo_item = items_[i];
-        items_[i] = nullptr;
-        size_--;
-        put(*redo_item[i]->first);
-        i = (i + 1) % tableSize_;
-        delete redo_item;
-    }
+    slots_[i].~Key();
     size_--;
-    // Possibly add a trigger to a rehash to a smaller table
-    return;
+
+    Group group(&ctrl_[i / Group::WIDTH * Group::WIDTH]);
+    if (group.match_empty()){
+        ctrl_[i] = CTRL_EMPTY;
+        used_--;
+    } else {
+        ctrl_[i] = CTRL_DELETED;
+    }
 }
 
 template <class Key>
@@ -158,31 +415,243 @@ inline size_t HashSet<Key>::size() const {
     return size_;
 }
 
+/**
+ * Grows the table so that it holds at least n keys before the next
+ * rehash. Tombstones count against it.
+ */
+template <class Key>
+void HashSet<Key>::reserve(int n){
+    if (n > static_cast<int>(tableSize_ * maxLoad_) - (used_ - size_)){
+        resize(static_cast<int>(n / maxLoad_) + 1);
+    }
+}
+
+/**
+ * Inserts key(0) ... key(n - 1) on the threads of pool.
+ *
+ * The table is first grown to hold every key, so that it does not move
+ * while the threads insert into it. It is then split into regions of
+ * consecutive groups, and keys by the region of their home group. One
+ * thread inserts all the keys of a region, and only ever reads or writes
+ * control bytes and slots inside it, so threads share no memory. A key
+ * whose probe sequence runs out of its region is set aside and inserted
+ * once the threads are done.
+ */
+template <class Key>
+template <class KeyAt>
+void HashSet<Key>::put_parallel(size_t n, KeyAt key, ThreadPool& pool){
+    if (n < PARALLEL_MIN || pool.size() == 1){
+        for (size_t i = 0; i < n; i++){
+            insert(key(i));
+        }
+        return;
+    }
+    reserve(size_ + static_cast<int>(n));
+
+    // A key's region is the top bits of its home group
+    size_t regions = std::min(static_cast<size_t>(PARTITIONS), static_cast<size_t>(groups()));
+    int shift = 0;
+    while ((static_cast<size_t>(groups()) >> shift) > regions){
+        shift++;
+    }
+
+    // Hash every key, and count each chunk's keys in each region
+    size_t chunks = pool.size() * 4;
+    size_t chunkSize = (n + chunks - 1) / chunks;
+    std::vector<size_t> hashes(n);
+    std::vector<size_t> offsets(chunks * regions, 0);
+    pool.run(chunks, [&](size_t c){
+        size_t* counts = &offsets[c * regions];
+        for (size_t i = c * chunkSize; i < std::min(n, (c + 1) * chunkSize); i++){
+            hashes[i] = mix_hash(hashcode(key(i)));
+            counts[(h1(hashes[i]) & group_mask()) >> shift]++;
+        }
+    });
+
+    // Lay the regions' keys out one after another, each chunk's keys in
+    // chunk order, and scatter the key indices into place
+    std::vector<size_t> starts(regions + 1);
+    size_t total = 0;
+    for (size_t r = 0; r < regions; r++){
+        starts[r] = total;
+        for (size_t c = 0; c < chunks; c++){
+            size_t count = offsets[c * regions + r];
+            offsets[c * regions + r] = total;
+            total += count;
+        }
+    }
+    starts[regions] = total;
+    std::vector<size_t> order(n);
+    pool.run(chunks, [&](size_t c){
+        size_t* next = &offsets[c * regions];
+        for (size_t i = c * chunkSize; i < std::min(n, (c + 1) * chunkSize); i++){
+            order[next[(h1(hashes[i]) & group_mask()) >> shift]++] = i;
+        }
+    });
+
+    std::vector<int> added(regions, 0);
+    std::vector<std::vector<size_t> > overflow(regions);
+    pool.run(regions, [&](size_t r){
+        int count = 0;
+        for (size_t k = starts[r]; k < starts[r + 1]; k++){
+            int claimed = claim(key(order[k]), hashes[order[k]], shift, r);
+            if (claimed < 0){
+                overflow[r].push_back(order[k]);
+            } else {
+                count += claimed;
+            }
+        }
+        added[r] = count;
+    });
+    for (int count : added){
+        size_ += count;
+        used_ += count;
+    }
+    for (auto& keys : overflow){
+        for (size_t i : keys){
+            insert(key(i));
+        }
+    }
+}
+
+/**
+ * Inserts key, unless it is already present, for put_parallel, probing
+ * only the groups whose index shifted right by shift is region. Returns 1
+ * if the key was inserted, 0 if it was present, and -1 if its probe
+ * sequence left the region first. Unlike insert, this never reuses a
+ * tombstone, so that a key past one is still found.
+ */
+template <class Key>
+int HashSet<Key>::claim(const Key& key, size_t hash, int shift, size_t region){
+    int8_t fragment = h2(hash);
+    int g = h1(hash) & group_mask();
+
+    for (int n = 0; n < groups(); n++){
+        if ((static_cast<size_t>(g) >> shift) != region){
+            return -1;
+        }
+        int base = g * Group::WIDTH;
+        Group group(&ctrl_[base]);
+
+        for (uint32_t match = group.match(fragment); match; match &= match - 1){
+            if (slots_[base + lowest_bit(match)] == key){
+                return 0;
+            }
+        }
+        uint32_t empty = group.match_empty();
+        if (empty){
+            int i = base + lowest_bit(empty);
+            new (&slots_[i]) Key(key);
+            ctrl_[i] = fragment;
+            return 1;
+        }
+        // Triangular probing visits every group of a power-of-two table
+        g = (g + n + 1) & group_mask();
+    }
+    return -1;
+}
+
+/**
+ * Returns pointers to the keys for which keep returns true, scanning a
+ * chunk of the table per task on the threads of pool.
+ */
+template <class Key>
+template <class Keep>
+std::vector<const Key*> HashSet<Key>::gather(Keep keep, ThreadPool& pool) const {
+    if (!tableSize_){
+        return std::vector<const Key*>();
+    }
+    size_t chunks = std::min(static_cast<size_t>(groups()), static_cast<size_t>(pool.size() * 4));
+    size_t chunkSize = (groups() + chunks - 1) / chunks * Group::WIDTH;
+    std::vector<std::vector<const Key*> > kept(chunks);
+    pool.run(chunks, [&](size_t c){
+        for (size_t i = c * chunkSize; i < std::min(static_cast<size_t>(tableSize_), (c + 1) * chunkSize); i++){
+            if (full(i) && keep(slots_[i])){
+                kept[c].push_back(&slots_[i]);
+            }
+        }
+    });
+
+    std::vector<const Key*> keys;
+    for (auto& chunk : kept){
+        keys.insert(keys.end(), chunk.begin(), chunk.end());
+    }
+    return keys;
+}
+
+/**
+ * Returns the keys in either a or b. Both sets are scanned in parallel,
+ * and the result built with a parallel insert.
+ */
+template <class Key>
+HashSet<Key> set_union(const HashSet<Key>& a, const HashSet<Key>& b, ThreadPool& pool){
+    std::vector<const Key*> keys = a.gather([](const Key&){ return true; }, pool);
+    std::vector<const Key*> extra = b.gather([&](const Key& key){ return !a.contains(key); }, pool);
+    keys.insert(keys.end(), extra.begin(), extra.end());
+
+    HashSet<Key> result;
+    result.put_parallel(keys.size(), [&](size_t i) -> const Key& { return *keys[i]; }, pool);
+    return result;
+}
+
+/**
+ * Returns the keys in both a and b, scanning the smaller set in parallel.
+ */
+template <class Key>
+HashSet<Key> set_intersection(const HashSet<Key>& a, const HashSet<Key>& b, ThreadPool& pool){
+    const HashSet<Key>& large = a.size() >= b.size() ? a : b;
+    const HashSet<Key>& small = a.size() >= b.size() ? b : a;
+    std::vector<const Key*> keys = small.gather([&](const Key& key){ return large.contains(key); }, pool);
+
+    HashSet<Key> result;
+    result.put_parallel(keys.size(), [&](size_t i) -> const Key& { return *keys[i]; }, pool);
+    return result;
+}
+
+/**
+ * Returns the keys in a but not in b, scanning a in parallel.
+ */
+template <class Key>
+HashSet<Key> set_difference(const HashSet<Key>& a, const HashSet<Key>& b, ThreadPool& pool){
+    std::vector<const Key*> keys = a.gather([&](const Key& key){ return !b.contains(key); }, pool);
+
+    HashSet<Key> result;
+    result.put_parallel(keys.size(), [&](size_t i) -> const Key& { return *keys[i]; }, pool);
+    return result;
+}
+
 /** 
  * Resizes the HashSet and rehashes all of the keys into new
- * locations.
+ * locations, dropping any tombstones.
  */
 template <class Key>
 void HashSet<Key>::resize(int newSize){
-    std::vector<Key*> old = items_;
+    Key* oldSlots = slots_;
+    std::vector<int8_t> oldCtrl(table_capacity(newSize), CTRL_EMPTY);
+    oldCtrl.swap(ctrl_);
+    int oldSize = tableSize_;
 
-    // Reset
-    items_.resize(newSize);
-    for (int i = 0; i < newSize; i++){
-        items_[i] = nullptr;
-    }
+    tableSize_ = table_capacity(newSize);
+    slots_ = alloc_.allocate(tableSize_);
+    used_ = size_;
 
     // Rehash
-    for (int i = 0; i < tableSize_; i++){
-        if (old[i]){
-            int i = hashcode(*old[i]) % tableSize_;
-            while(items_[i]){
-                i = (i + 1) % tableSize_;
+    for (int j = 0; j < oldSize; j++){
+        if (oldCtrl[j] >= 0){
+            size_t hash = mix_hash(hashcode(oldSlots[j]));
+            int g = h1(hash) & group_mask();
+            uint32_t free;
+            for (int n = 1; !(free = Group(&ctrl_[g * Group::WIDTH]).match_empty()); n++){
+                g = (g + n) & group_mask();
             }
-            items_[i] = old[i];
+            int i = g * Group::WIDTH + lowest_bit(free);
+
+            new (&slots_[i]) Key(std::move(oldSlots[j]));
+            ctrl_[i] = h2(hash);
+            oldSlots[j].~Key();
         }
     }
-    tableSize_ = newSize;
+    alloc_.deallocate(oldSlots, oldSize);
 };
 
 template <class Key>
@@ -211,12 +680,8 @@ template <class Key>
 class HashSet<Key>::Iterator {
 public:
     Iterator(const HashSet<Key>* set, int counter) : set_(set), counter_(counter) {
-        if (set_->size_ > 0){
-            // Find the first non-null element in the table
-            while (!set_->items_[counter_]){
-                counter_++;
-            }
-        }
+        // Find the first full slot in the table
+        skip();
     }
     Iterator& operator++(){
         increment();
@@ -234,25 +699,31 @@ public:
         return other.set_ != set_ || other.counter_ != counter_;
     }
     const Key& operator*(){
-        return *(set_->items_[counter_]);
+        return set_->slots_[counter_];
     }
 private:
     const HashSet<Key>* set_;
     size_t counter_ = 0;
 
+    /**
+     * Advances the counter until we have a full slot
+     * or reach the end.
+     */
+    void skip(){
+        size_t tableSize = set_->tableSize_;
+        while (counter_ < tableSize && !set_->full(counter_)){
+            counter_++;
+        }
+    }
+
     /** 
      * Guarantees the counter moves at least once,
-     * then continues until we have a non-null element
+     * then continues until we have a full slot
      * or reach the end.
      */
     void increment(){
         counter_++;
-        while (counter_ < set_->tableSize_ && !set_->items_[counter_]){
-            counter_++;
-        }
-        if (counter_ > set_->tableSize_){
-            counter_ = set_->tableSize_;
-        }
+        skip();
     }
 };
 #endif // HASH_SET_H_
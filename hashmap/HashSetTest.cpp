@@ -1,6 +1,7 @@
 #define BOOST_TEST_MODULE HashSet test
 #include <iostream>
 #include <string>
+#include <vector>
 
 #include <boost/test/unit_test.hpp>
 
@@ -43,13 +44,253 @@ BOOST_AUTO_TEST_CASE(duplicate_test){
 }
 
 BOOST_AUTO_TEST_CASE(rehash_test){
+    const int TEST_SIZE = 1000;
+
+    HashSet<int> set;
+    for (int i = 0; i < TEST_SIZE; i++){
+        set.put(i);
+    }
+
+    BOOST_CHECK_EQUAL(set.size(), TEST_SIZE);
+    for (int i = 0; i < TEST_SIZE; i++){
+        BOOST_CHECK(set.contains(i));
+    }
 }
 
 BOOST_AUTO_TEST_CASE(iteration_test){
+    const int TEST_SIZE = 100;
+
+    HashSet<int> set;
+    BOOST_CHECK(set.begin() == set.end());
+
+    for (int i = 0; i < TEST_SIZE; i++){
+        set.put(i);
+    }
+
+    std::vector<bool> seen(TEST_SIZE, false);
+    int count = 0;
+    for (auto& x : set){
+        BOOST_CHECK(!seen[x]);
+        seen[x] = true;
+        count++;
+    }
+    BOOST_CHECK_EQUAL(count, TEST_SIZE);
 }
 
 BOOST_AUTO_TEST_CASE(contains_test){
+    HashSet<std::string> set = { "Dog", "Cat", "Monkey" };
+
+    BOOST_CHECK(set.contains("Dog"));
+    BOOST_CHECK(set.contains("Monkey"));
+    BOOST_CHECK(!set.contains("Lion"));
+}
+
+BOOST_AUTO_TEST_CASE(remove_test){
+    const int TEST_SIZE = 500;
+
+    HashSet<int> set;
+    for (int i = 0; i < TEST_SIZE; i++){
+        set.put(i);
+    }
+    for (int i = 0; i < TEST_SIZE; i += 3){
+        set.remove(i);
+    }
+    set.remove(-1);
+
+    for (int i = 0; i < TEST_SIZE; i++){
+        BOOST_CHECK_EQUAL(set.contains(i), i % 3 != 0);
+    }
+    BOOST_CHECK_EQUAL(set.size(), TEST_SIZE - (TEST_SIZE + 2) / 3);
+}
+
+BOOST_AUTO_TEST_CASE(copy_after_remove_test){
+    // A full table leaves probe sequences running through groups that
+    // only hold tombstones after the removals; copies must still find
+    // every key past them
+    const int TEST_SIZE = 100000;
+
+    HashSet<int> set;
+    set.set_max_load(0.875);
+    for (int i = 0; i < TEST_SIZE; i++){
+        set.put(i);
+    }
+    for (int i = 0; i < TEST_SIZE; i += 3){
+        set.remove(i);
+    }
+
+    HashSet<int> copy(set);
+    HashSet<int> assigned;
+    assigned = set;
+    int missing = 0;
+    for (int i = 0; i < TEST_SIZE; i++){
+        bool expected = i % 3 != 0;
+        missing += set.contains(i) != expected;
+        missing += copy.contains(i) != expected;
+        missing += assigned.contains(i) != expected;
+    }
+    BOOST_CHECK_EQUAL(missing, 0);
+    BOOST_CHECK_EQUAL(copy.size(), set.size());
+    BOOST_CHECK_EQUAL(assigned.size(), set.size());
 }
 
 BOOST_AUTO_TEST_CASE(clear_test){
 }
+
+BOOST_AUTO_TEST_CASE(heterogeneous_lookup_test){
+    HashSet<std::string> set = { "Dog", "Cat" };
+
+    const char* cat = "Cat";
+    BOOST_CHECK(set.contains(cat));
+    BOOST_CHECK(!set.contains("Cow"));
+
+#if __cplusplus >= 201703L
+    std::string buffer = "GET /Dog HTTP/1.1";
+    std::string_view dog(buffer.data() + 5, 3);
+    BOOST_CHECK(set.contains(dog));
+
+    set.put(std::string_view(buffer.data(), 3));
+    BOOST_CHECK(set.contains("GET"));
+    set.remove(dog);
+    BOOST_CHECK(!set.contains("Dog"));
+#endif
+    set.remove(cat);
+    BOOST_CHECK_EQUAL(set.size(), 1);
+}
+
+BOOST_AUTO_TEST_CASE(move_test){
+    HashSet<std::string> set = { "Dog", "Cat", "Monkey" };
+
+    HashSet<std::string> moved(std::move(set));
+    BOOST_CHECK_EQUAL(moved.size(), 3);
+    BOOST_CHECK(moved.contains("Cat"));
+
+    // A moved-from set is empty, but still usable
+    BOOST_CHECK_EQUAL(set.size(), 0);
+    BOOST_CHECK(!set.contains("Cat"));
+    BOOST_CHECK(set.begin() == set.end());
+    set.put("Giraffe");
+    BOOST_CHECK(set.contains("Giraffe"));
+
+    set = std::move(moved);
+    BOOST_CHECK_EQUAL(set.size(), 3);
+    BOOST_CHECK(!set.contains("Giraffe"));
+}
+
+BOOST_AUTO_TEST_CASE(emplace_test){
+    HashSet<std::string> set;
+
+    BOOST_CHECK(set.emplace(3, 'x'));
+    BOOST_CHECK(!set.emplace("xxx"));
+    BOOST_CHECK(set.contains("xxx"));
+
+    std::string key = "Dog";
+    set.put(std::move(key));
+    BOOST_CHECK(set.contains("Dog"));
+    BOOST_CHECK_EQUAL(set.size(), 2);
+}
+
+BOOST_AUTO_TEST_CASE(parallel_bulk_test){
+    ThreadPool pool(4);
+
+    // Enough keys to take the parallel path, with every key given twice
+    const int TEST_SIZE = 100000;
+    std::vector<std::string> keys;
+    for (int i = 0; i < 2 * TEST_SIZE; i++){
+        keys.push_back("key" + std::to_string(i % TEST_SIZE));
+    }
+    HashSet<std::string> set(keys.begin(), keys.end(), pool);
+
+    BOOST_CHECK_EQUAL(set.size(), TEST_SIZE);
+    int count = 0;
+    for (auto iter = set.begin(); iter != set.end(); iter++){
+        count++;
+    }
+    BOOST_CHECK_EQUAL(count, TEST_SIZE);
+    for (int i = 0; i < TEST_SIZE; i++){
+        BOOST_CHECK(set.contains("key" + std::to_string(i)));
+    }
+
+    // Bulk insert on top of existing keys and tombstones
+    set.remove("key0");
+    std::vector<std::string> more = { "key0", "key1", "extra" };
+    set.insert_bulk(more.begin(), more.end(), pool);
+    BOOST_CHECK_EQUAL(set.size(), TEST_SIZE + 1);
+    BOOST_CHECK(set.contains("key0"));
+    BOOST_CHECK(set.contains("extra"));
+}
+
+// Hashes runs of 512 consecutive values alike, so their probe sequences
+// pile up over dozens of groups
+struct Clumped {
+    int value;
+
+    bool operator==(const Clumped& other) const { return value == other.value; }
+};
+
+template <>
+struct Hash<Clumped> {
+    size_t operator()(const Clumped& k) const {
+        return k.value / 512;
+    }
+};
+
+BOOST_AUTO_TEST_CASE(parallel_overflow_test){
+    ThreadPool pool(4);
+
+    // Long probe sequences run past the end of a thread's region of the
+    // table, and those keys are inserted once the threads are done
+    const int TEST_SIZE = 50000;
+    HashSet<Clumped> set;
+    for (int i = 0; i < TEST_SIZE; i += 2){
+        set.put(Clumped{i});
+    }
+    for (int i = 0; i < TEST_SIZE; i += 10){
+        set.remove(Clumped{i});
+    }
+
+    std::vector<Clumped> keys;
+    for (int i = 0; i < 2 * TEST_SIZE; i++){
+        keys.push_back(Clumped{i % TEST_SIZE});
+    }
+    set.insert_bulk(keys.begin(), keys.end(), pool);
+
+    BOOST_CHECK_EQUAL(set.size(), TEST_SIZE);
+    int count = 0;
+    for (auto iter = set.begin(); iter != set.end(); iter++){
+        count++;
+    }
+    BOOST_CHECK_EQUAL(count, TEST_SIZE);
+    int missing = 0;
+    for (int i = 0; i < TEST_SIZE; i++){
+        missing += !set.contains(Clumped{i});
+    }
+    BOOST_CHECK_EQUAL(missing, 0);
+}
+
+BOOST_AUTO_TEST_CASE(parallel_algebra_test){
+    ThreadPool pool(4);
+
+    const int TEST_SIZE = 60000;
+    HashSet<int> a, b;
+    for (int i = 0; i < TEST_SIZE; i++){
+        a.put(2 * i);
+        b.put(3 * i);
+    }
+
+    HashSet<int> both = set_union(a, b, pool);
+    HashSet<int> common = set_intersection(a, b, pool);
+    HashSet<int> onlyA = set_difference(a, b, pool);
+    for (int i = 0; i < 3 * TEST_SIZE; i++){
+        bool inA = i % 2 == 0 && i < 2 * TEST_SIZE;
+        bool inB = i % 3 == 0;
+        BOOST_CHECK_EQUAL(both.contains(i), inA || inB);
+        BOOST_CHECK_EQUAL(common.contains(i), inA && inB);
+        BOOST_CHECK_EQUAL(onlyA.contains(i), inA && !inB);
+    }
+    BOOST_CHECK_EQUAL(common.size(), TEST_SIZE / 3);
+    BOOST_CHECK_EQUAL(both.size(), a.size() + b.size() - common.size());
+
+    // The shared pool, and sets too small to be worth splitting
+    HashSet<int> small = { 1, 2, 3 };
+    BOOST_CHECK_EQUAL(set_intersection(small, a).size(), 1);
+}
@@ -0,0 +1,93 @@
+#define BOOST_TEST_MODULE Hash test
+#include <iostream>
+#include <string>
+#include <vector>
+#include <tuple>
+#include <utility>
+
+#include <boost/test/unit_test.hpp>
+
+#include "Hash.h"
+
+BOOST_AUTO_TEST_CASE(string_test){
+    Hash<std::string> hash;
+
+    // Cover every length class: empty, 1-3, 4-16, 17-48 and longer
+    std::string url = "https://example.com/some/fairly/long/path?with=query&and=more";
+    for (size_t len = 0; len <= url.size(); len++){
+        std::string prefix = url.substr(0, len);
+        BOOST_CHECK_EQUAL(hash(prefix), hash(std::string(prefix)));
+        if (len > 0){
+            BOOST_CHECK(hash(prefix) != hash(url.substr(0, len - 1)));
+        }
+    }
+    BOOST_CHECK(hash("abcdefgh") != hash("abcdefgi"));
+}
+
+#if __cplusplus >= 201703L
+BOOST_AUTO_TEST_CASE(string_view_test){
+    Hash<std::string> hash;
+    Hash<std::string_view> viewHash;
+
+    std::string key = "a key that is longer than sixteen bytes";
+    BOOST_CHECK_EQUAL(hash(key), viewHash(std::string_view(key)));
+}
+#endif
+
+BOOST_AUTO_TEST_CASE(wide_test){
+    // The low half is the 64-bit hash, and the high half a second one
+    std::string url = "https://example.com/some/fairly/long/path?with=query&and=more";
+    for (size_t len = 0; len <= url.size(); len++){
+        Hash128 hash = hash_bytes128(url.data(), len, 7);
+        BOOST_CHECK_EQUAL(hash.low, hash_bytes(url.data(), len, 7));
+        BOOST_CHECK(hash.high != hash.low);
+    }
+    BOOST_CHECK(hash_bytes128("Dog", 3, 0).high != hash_bytes128("Cat", 3, 0).high);
+}
+
+BOOST_AUTO_TEST_CASE(integral_test){
+    BOOST_CHECK_EQUAL(Hash<int>()(42), Hash<int>()(42));
+    BOOST_CHECK(Hash<char>()('a') != Hash<char>()('b'));
+    BOOST_CHECK(Hash<unsigned long long>()(1) != Hash<unsigned long long>()(2));
+    BOOST_CHECK(Hash<short>()(-1) != Hash<short>()(1));
+
+    int x = 0, y = 0;
+    BOOST_CHECK(Hash<int*>()(&x) != Hash<int*>()(&y));
+}
+
+BOOST_AUTO_TEST_CASE(composite_test){
+    Hash<std::pair<int, std::string> > pairHash;
+    BOOST_CHECK_EQUAL(pairHash(std::make_pair(1, std::string("a"))), pairHash(std::make_pair(1, std::string("a"))));
+    BOOST_CHECK(pairHash(std::make_pair(1, std::string("a"))) != pairHash(std::make_pair(2, std::string("a"))));
+
+    Hash<std::tuple<int, int, int> > tupleHash;
+    BOOST_CHECK(tupleHash(std::make_tuple(1, 2, 3)) != tupleHash(std::make_tuple(3, 2, 1)));
+}
+
+BOOST_AUTO_TEST_CASE(seed_test){
+    Hash<std::string> unseeded;
+
+    set_hash_seed(0x1234);
+    Hash<std::string> seeded;
+    Hash<int> seededInt;
+    set_hash_seed(0);
+
+    BOOST_CHECK(unseeded("key") != seeded("key"));
+    BOOST_CHECK(Hash<int>()(7) != seededInt(7));
+}
+
+BOOST_AUTO_TEST_CASE(distribution_test){
+    // Sequential ids should spread evenly over the low 7 bits, which pick
+    // the control byte fragment in the hash tables
+    const int BUCKETS = 128;
+    const int TEST_SIZE = BUCKETS * 100;
+
+    std::vector<int> counts(BUCKETS, 0);
+    Hash<int> hash;
+    for (int i = 0; i < TEST_SIZE; i++){
+        counts[hash(i) % BUCKETS]++;
+    }
+    for (int count : counts){
+        BOOST_CHECK(count > 50 && count < 150);
+    }
+}
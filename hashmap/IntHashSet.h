@@ -0,0 +1,570 @@
+/*
+ * Copyright (C) 2013 Christian Briones
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense, 
+ * and/or sell copies of the Software, and to permit persons to whom the 
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included 
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, 
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES 
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR
+ * ANY CLAIM, DAMAGES, OR OTHER LIABILITY, WHETHER IN AN ACTION OF
+ * CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+ * WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef INT_HASH_SET_H_
+#define INT_HASH_SET_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <algorithm>
+#include <initializer_list>
+#include <limits>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+#include "Hash.h"
+#include "Group.h"
+
+namespace int_set_detail {
+    /**
+     * A group of consecutive integer slots, loaded and compared in one
+     * step. Like Group, matches are returned as a bitmask with bit i set
+     * for the i-th slot, but the slots hold the keys themselves.
+     */
+    template <class T, size_t Size = sizeof(T)>
+    struct IntGroup;
+
+    template <class T>
+    struct IntGroup<T, 4> {
+#if defined(__AVX2__)
+        static const int WIDTH = 8;
+
+        explicit IntGroup(const T* pos) :
+            slots(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(pos))) {}
+
+        uint32_t match(T key) const {
+            __m256i eq = _mm256_cmpeq_epi32(slots, _mm256_set1_epi32(static_cast<int32_t>(key)));
+            return _mm256_movemask_ps(_mm256_castsi256_ps(eq));
+        }
+
+        __m256i slots;
+#elif defined(__SSE2__)
+        static const int WIDTH = 4;
+
+        explicit IntGroup(const T* pos) :
+            slots(_mm_loadu_si128(reinterpret_cast<const __m128i*>(pos))) {}
+
+        uint32_t match(T key) const {
+            __m128i eq = _mm_cmpeq_epi32(slots, _mm_set1_epi32(static_cast<int32_t>(key)));
+            return _mm_movemask_ps(_mm_castsi128_ps(eq));
+        }
+
+        __m128i slots;
+#else
+        static const int WIDTH = 4;
+
+        explicit IntGroup(const T* pos) : pos(pos) {}
+
+        uint32_t match(T key) const {
+            uint32_t mask = 0;
+            for (int i = 0; i < WIDTH; i++){
+                mask |= static_cast<uint32_t>(pos[i] == key) << i;
+            }
+            return mask;
+        }
+
+        const T* pos;
+#endif
+    };
+
+    template <class T>
+    struct IntGroup<T, 8> {
+#if defined(__AVX2__)
+        static const int WIDTH = 4;
+
+        explicit IntGroup(const T* pos) :
+            slots(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(pos))) {}
+
+        uint32_t match(T key) const {
+            __m256i eq = _mm256_cmpeq_epi64(slots, _mm256_set1_epi64x(static_cast<int64_t>(key)));
+            return _mm256_movemask_pd(_mm256_castsi256_pd(eq));
+        }
+
+        __m256i slots;
+#elif defined(__SSE2__)
+        static const int WIDTH = 2;
+
+        explicit IntGroup(const T* pos) :
+            slots(_mm_loadu_si128(reinterpret_cast<const __m128i*>(pos))) {}
+
+        uint32_t match(T key) const {
+            // SSE2 only compares 32-bit lanes, so a 64-bit lane matches
+            // where both of its halves do
+            __m128i eq = _mm_cmpeq_epi32(slots, _mm_set1_epi64x(static_cast<int64_t>(key)));
+            eq = _mm_and_si128(eq, _mm_shuffle_epi32(eq, _MM_SHUFFLE(2, 3, 0, 1)));
+            return _mm_movemask_pd(_mm_castsi128_pd(eq));
+        }
+
+        __m128i slots;
+#else
+        static const int WIDTH = 2;
+
+        explicit IntGroup(const T* pos) : pos(pos) {}
+
+        uint32_t match(T key) const {
+            uint32_t mask = 0;
+            for (int i = 0; i < WIDTH; i++){
+                mask |= static_cast<uint32_t>(pos[i] == key) << i;
+            }
+            return mask;
+        }
+
+        const T* pos;
+#endif
+    };
+}
+
+/**
+ * Hash set of 32 or 64-bit integers, stored as a flat array of the keys
+ * themselves.
+ *
+ * Where HashSet keeps a control byte per slot, this marks empty and
+ * deleted slots with two sentinel key values (the largest two), so a slot
+ * costs exactly sizeof(T). A probe compares a whole group of keys against
+ * the key sought, and against the empty sentinel, in two SIMD compares.
+ * The sentinel values themselves can still be stored: they are tracked by
+ * a flag each, outside the table.
+ *
+ * The set operations (set_union, set_intersection, set_difference) scan
+ * one set a group of slots at a time, and look its keys up in the other
+ * in batches with contains_batch.
+ */
+template <class T>
+class IntHashSet {
+    static_assert(std::is_integral<T>::value && (sizeof(T) == 4 || sizeof(T) == 8),
+            "IntHashSet holds 32 or 64-bit integers");
+
+    typedef int_set_detail::IntGroup<T> Group;
+public:
+    static const T EMPTY = std::numeric_limits<T>::max();
+    static const T DELETED = std::numeric_limits<T>::max() - 1;
+
+    IntHashSet(){}
+    IntHashSet(std::initializer_list<T> list){
+        reserve(list.size());
+        for (T key : list){
+            put(key);
+        }
+    }
+
+    void put(T key);
+    void remove(T key);
+    bool contains(T key) const {
+        return is_sentinel(key) ? special_[key == DELETED] : find(key) >= 0;
+    }
+    size_t contains_batch(const T* keys, size_t n, bool* out) const;
+
+    float max_load() const {
+        return maxLoad_;
+    }
+    void set_max_load(float maxLoad){
+        maxLoad_ = maxLoad;
+    }
+    size_t size() const {
+        return size_;
+    }
+    void reserve(size_t n);
+
+    class Iterator;
+    Iterator begin() const;
+    Iterator end() const;
+
+    template <class Visit>
+    void for_each(Visit visit) const;
+private:
+    // Number of keys hashed and prefetched ahead of probing by
+    // contains_batch (see HashMap::BATCH)
+    static const int BATCH = 16;
+
+    size_t size_ = 0; // Number of keys, sentinel values included
+    size_t used_ = 0; // Number of slots that are not empty, including tombstones
+    size_t tableSize_ = table_size(64);
+    float maxLoad_ = 0.5;
+    bool special_[2] = { false, false }; // Whether EMPTY and DELETED are in the set
+    Hash<T> hashcode;
+    std::vector<T> slots_ = std::vector<T>(tableSize_, EMPTY);
+
+    static bool is_sentinel(T key){
+        return key == EMPTY || key == DELETED;
+    }
+    static size_t table_size(size_t n){
+        size_t size = Group::WIDTH;
+        while (size < n){
+            size *= 2;
+        }
+        return size;
+    }
+    size_t group_mask() const {
+        return tableSize_ / Group::WIDTH - 1;
+    }
+    size_t home(size_t hash) const {
+        return (hash & group_mask()) * Group::WIDTH;
+    }
+    uint32_t match_free(const Group& group) const {
+        return group.match(EMPTY) | group.match(DELETED);
+    }
+    long probe(T key, size_t hash) const;
+    long find(T key) const {
+        return probe(key, mix_hash(hashcode(key)));
+    }
+    void grow();
+    void resize(size_t newSize);
+};
+
+template <class T>
+const T IntHashSet<T>::EMPTY;
+template <class T>
+const T IntHashSet<T>::DELETED;
+
+/**
+ * Returns the index of the slot holding key, or -1 if it is not present.
+ */
+template <class T>
+long IntHashSet<T>::probe(T key, size_t hash) const {
+    size_t groups = tableSize_ / Group::WIDTH;
+    size_t g = hash & group_mask();
+    for (size_t n = 0; n < groups; n++){
+        Group group(&slots_[g * Group::WIDTH]);
+        uint32_t match = group.match(key);
+        if (match){
+            return g * Group::WIDTH + lowest_bit(match);
+        }
+        // An empty slot ends every probe sequence that reached this group
+        if (group.match(EMPTY)){
+            return -1;
+        }
+        // Triangular probing visits every group of a power-of-two table
+        g = (g + n + 1) & group_mask();
+    }
+    return -1;
+}
+
+/**
+ * Inserts the key into the IntHashSet.
+ */
+template <class T>
+void IntHashSet<T>::put(T key){
+    if (is_sentinel(key)){
+        size_ += !special_[key == DELETED];
+        special_[key == DELETED] = true;
+        return;
+    }
+    grow();
+
+    size_t hash = mix_hash(hashcode(key));
+    size_t g = hash & group_mask();
+    long target = -1;
+    for (size_t n = 0; n < tableSize_ / Group::WIDTH; n++){
+        Group group(&slots_[g * Group::WIDTH]);
+        if (group.match(key)){
+            return;
+        }
+        uint32_t free = match_free(group);
+        if (target < 0 && free){
+            target = g * Group::WIDTH + lowest_bit(free);
+        }
+        if (group.match(EMPTY)){
+            break;
+        }
+        g = (g + n + 1) & group_mask();
+    }
+    if (slots_[target] == EMPTY){
+        used_++;
+    }
+    slots_[target] = key;
+    size_++;
+}
+
+/*
+ * Removes a key from the IntHashSet, leaving a tombstone only if some
+ * probe sequence may have continued past its group.
+ */
+template <class T>
+void IntHashSet<T>::remove(T key){
+    if (is_sentinel(key)){
+        size_ -= special_[key == DELETED];
+        special_[key == DELETED] = false;
+        return;
+    }
+    long i = find(key);
+    if (i < 0){
+        return;
+    }
+    size_--;
+    if (Group(&slots_[i / Group::WIDTH * Group::WIDTH]).match(EMPTY)){
+        slots_[i] = EMPTY;
+        used_--;
+    } else {
+        slots_[i] = DELETED;
+    }
+}
+
+/**
+ * Looks up n keys at once, storing whether each is present in out, and
+ * returns the number present. All the keys of a batch are hashed and
+ * their first group prefetched before any is probed, so that their cache
+ * misses overlap.
+ */
+template <class T>
+size_t IntHashSet<T>::contains_batch(const T* keys, size_t n, bool* out) const {
+    size_t hashes[BATCH];
+    size_t found = 0;
+    for (size_t start = 0; start < n; start += BATCH){
+        size_t count = std::min(n - start, static_cast<size_t>(BATCH));
+        for (size_t k = 0; k < count; k++){
+            hashes[k] = mix_hash(hashcode(keys[start + k]));
+            __builtin_prefetch(&slots_[home(hashes[k])]);
+        }
+        for (size_t k = 0; k < count; k++){
+            T key = keys[start + k];
+            bool present = is_sentinel(key) ? special_[key == DELETED] : probe(key, hashes[k]) >= 0;
+            out[start + k] = present;
+            found += present;
+        }
+    }
+    return found;
+}
+
+/**
+ * Calls visit with every key in the set, finding the full slots of a
+ * group at a time.
+ */
+template <class T>
+template <class Visit>
+void IntHashSet<T>::for_each(Visit visit) const {
+    const uint32_t lanes = (1u << Group::WIDTH) - 1;
+    for (size_t base = 0; base < tableSize_; base += Group::WIDTH){
+        Group group(&slots_[base]);
+        for (uint32_t full = ~match_free(group) & lanes; full; full &= full - 1){
+            visit(slots_[base + lowest_bit(full)]);
+        }
+    }
+    if (special_[0]){
+        visit(EMPTY);
+    }
+    if (special_[1]){
+        visit(DELETED);
+    }
+}
+
+/**
+ * Grows the table so that it holds at least n keys before the next
+ * rehash.
+ */
+template <class T>
+void IntHashSet<T>::reserve(size_t n){
+    if (n > static_cast<size_t>(tableSize_ * maxLoad_)){
+        resize(static_cast<size_t>(n / maxLoad_) + 1);
+    }
+}
+
+/**
+ * Double the size of the table if the load factor (counting tombstones)
+ * exceeds the max. If most of the load is tombstones the table is instead
+ * rehashed at its current size.
+ */
+template <class T>
+void IntHashSet<T>::grow(){
+    size_t limit = static_cast<size_t>(tableSize_ * maxLoad_);
+    if (used_ + 1 > limit){
+        resize(size_ + 1 > limit / 2 ? tableSize_ * 2 : tableSize_);
+    }
+}
+
+/**
+ * Resizes the table and rehashes every key into it, dropping any
+ * tombstones.
+ */
+template <class T>
+void IntHashSet<T>::resize(size_t newSize){
+    std::vector<T> old(table_size(newSize), EMPTY);
+    old.swap(slots_);
+    tableSize_ = slots_.size();
+    used_ = 0;
+
+    for (T key : old){
+        if (is_sentinel(key)){
+            continue;
+        }
+        size_t g = mix_hash(hashcode(key)) & group_mask();
+        uint32_t free;
+        for (size_t n = 1; !(free = Group(&slots_[g * Group::WIDTH]).match(EMPTY)); n++){
+            g = (g + n) & group_mask();
+        }
+        slots_[g * Group::WIDTH + lowest_bit(free)] = key;
+        used_++;
+    }
+}
+
+template <class T>
+typename IntHashSet<T>::Iterator IntHashSet<T>::begin() const {
+    return Iterator(this, 0);
+}
+
+template <class T>
+typename IntHashSet<T>::Iterator IntHashSet<T>::end() const {
+    return Iterator(this, tableSize_ + 2);
+}
+
+/**
+ * An iterator class for accessing the elements of the IntHashSet in no
+ * particular order. The counter runs through the table, and then over
+ * the two sentinel values.
+ *
+ * It is the responsibility of the client to no longer use an iterator
+ * after the set has been altered or destroyed.
+ */
+template <class T>
+class IntHashSet<T>::Iterator {
+public:
+    Iterator(const IntHashSet<T>* set, size_t counter) : set_(set), counter_(counter) {
+        skip();
+    }
+    Iterator& operator++(){
+        counter_++;
+        skip();
+        return *this;
+    }
+    Iterator operator++(int){
+        Iterator old(*this);
+        ++*this;
+        return old;
+    }
+    bool operator==(const Iterator& other) const {
+        return other.set_ == set_ && other.counter_ == counter_;
+    }
+    bool operator!=(const Iterator& other) const {
+        return !(*this == other);
+    }
+    T operator*() const {
+        size_t tableSize = set_->tableSize_;
+        return counter_ < tableSize ? set_->slots_[counter_] : counter_ == tableSize ? EMPTY : DELETED;
+    }
+private:
+    const IntHashSet<T>* set_;
+    size_t counter_;
+
+    bool full() const {
+        size_t tableSize = set_->tableSize_;
+        if (counter_ < tableSize){
+            return !is_sentinel(set_->slots_[counter_]);
+        }
+        return set_->special_[counter_ - tableSize];
+    }
+    void skip(){
+        size_t end = set_->tableSize_ + 2;
+        while (counter_ < end && !full()){
+            counter_++;
+        }
+    }
+};
+
+namespace int_set_detail {
+    /**
+     * Calls keep(key, found) for every key of from, where found is whether
+     * other contains it. Keys are gathered a batch at a time and looked up
+     * in other with contains_batch.
+     */
+    template <class T, class Keep>
+    void filter(const IntHashSet<T>& from, const IntHashSet<T>& other, Keep keep){
+        const size_t BATCH = 256;
+        T keys[BATCH];
+        bool found[BATCH];
+        size_t n = 0;
+        auto flush = [&](){
+            other.contains_batch(keys, n, found);
+            for (size_t k = 0; k < n; k++){
+                keep(keys[k], found[k]);
+            }
+            n = 0;
+        };
+        from.for_each([&](T key){
+            keys[n++] = key;
+            if (n == BATCH){
+                flush();
+            }
+        });
+        flush();
+    }
+}
+
+/**
+ * Returns the keys in either a or b.
+ */
+template <class T>
+IntHashSet<T> set_union(const IntHashSet<T>& a, const IntHashSet<T>& b){
+    const IntHashSet<T>& large = a.size() >= b.size() ? a : b;
+    const IntHashSet<T>& small = a.size() >= b.size() ? b : a;
+
+    IntHashSet<T> result(large);
+    result.reserve(large.size() + small.size());
+    int_set_detail::filter(small, large, [&](T key, bool found){
+        if (!found){
+            result.put(key);
+        }
+    });
+    return result;
+}
+
+/**
+ * Returns the keys in both a and b. The smaller set is scanned and looked
+ * up in the larger.
+ */
+template <class T>
+IntHashSet<T> set_intersection(const IntHashSet<T>& a, const IntHashSet<T>& b){
+    const IntHashSet<T>& large = a.size() >= b.size() ? a : b;
+    const IntHashSet<T>& small = a.size() >= b.size() ? b : a;
+
+    IntHashSet<T> result;
+    result.reserve(small.size());
+    int_set_detail::filter(small, large, [&](T key, bool found){
+        if (found){
+            result.put(key);
+        }
+    });
+    return result;
+}
+
+/**
+ * Returns the keys in a but not in b.
+ */
+template <class T>
+IntHashSet<T> set_difference(const IntHashSet<T>& a, const IntHashSet<T>& b){
+    IntHashSet<T> result;
+    result.reserve(a.size());
+    int_set_detail::filter(a, b, [&](T key, bool found){
+        if (!found){
+            result.put(key);
+        }
+    });
+    return result;
+}
+
+#endif // INT_HASH_SET_H_
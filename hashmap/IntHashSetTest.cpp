@@ -0,0 +1,121 @@
+#define BOOST_TEST_MODULE IntHashSet test
+#include <algorithm>
+#include <limits>
+#include <set>
+#include <vector>
+
+#include <boost/test/unit_test.hpp>
+
+#include "IntHashSet.h"
+
+template <class T>
+std::set<T> contents(const IntHashSet<T>& set){
+    std::set<T> keys;
+    for (auto iter = set.begin(); iter != set.end(); ++iter){
+        BOOST_CHECK(keys.insert(*iter).second);
+    }
+    return keys;
+}
+
+BOOST_AUTO_TEST_CASE(put_test){
+    IntHashSet<int> set = { 1, 3, 5, 3 };
+
+    BOOST_CHECK_EQUAL(set.size(), 3);
+    BOOST_CHECK(set.contains(3));
+    BOOST_CHECK(!set.contains(2));
+}
+
+BOOST_AUTO_TEST_CASE(sentinel_test){
+    // The sentinel values are keys like any other
+    IntHashSet<uint64_t> set;
+    uint64_t max = std::numeric_limits<uint64_t>::max();
+
+    BOOST_CHECK(!set.contains(max));
+    set.put(max);
+    set.put(max - 1);
+    set.put(max);
+    set.put(0);
+    BOOST_CHECK_EQUAL(set.size(), 3);
+    BOOST_CHECK(set.contains(max));
+    BOOST_CHECK(set.contains(max - 1));
+    BOOST_CHECK(contents(set) == std::set<uint64_t>({ 0, max - 1, max }));
+
+    set.remove(max);
+    BOOST_CHECK(!set.contains(max));
+    BOOST_CHECK(set.contains(max - 1));
+    BOOST_CHECK_EQUAL(set.size(), 2);
+}
+
+BOOST_AUTO_TEST_CASE(remove_test){
+    IntHashSet<int> set;
+
+    const int TEST_SIZE = 10000;
+    for (int i = 0; i < TEST_SIZE; i++){
+        set.put(i);
+    }
+    for (int i = 0; i < TEST_SIZE; i += 2){
+        set.remove(i);
+    }
+    set.remove(TEST_SIZE);
+
+    BOOST_CHECK_EQUAL(set.size(), TEST_SIZE / 2);
+    for (int i = 0; i < TEST_SIZE; i++){
+        BOOST_CHECK_EQUAL(set.contains(i), i % 2 == 1);
+    }
+
+    // Churn through the tombstones, replacing the last odd key
+    for (int i = TEST_SIZE; i < 10 * TEST_SIZE; i++){
+        set.put(i);
+        set.remove(i - 1);
+    }
+    BOOST_CHECK_EQUAL(set.size(), TEST_SIZE / 2);
+    BOOST_CHECK(set.contains(10 * TEST_SIZE - 1));
+    BOOST_CHECK_EQUAL(contents(set).size(), set.size());
+}
+
+BOOST_AUTO_TEST_CASE(batch_test){
+    IntHashSet<int64_t> set;
+    for (int64_t i = 0; i < 1000; i++){
+        set.put(i * i);
+    }
+    std::vector<int64_t> keys;
+    for (int64_t i = 0; i < 2000; i++){
+        keys.push_back(i);
+    }
+    std::unique_ptr<bool[]> found(new bool[keys.size()]);
+    BOOST_CHECK_EQUAL(set.contains_batch(keys.data(), keys.size(), found.get()), 45);
+    for (size_t k = 0; k < keys.size(); k++){
+        BOOST_CHECK_EQUAL(found[k], set.contains(keys[k]));
+    }
+}
+
+BOOST_AUTO_TEST_CASE(algebra_test){
+    IntHashSet<int> a, b;
+    std::set<int> expectA, expectB;
+    for (int i = 0; i < 5000; i++){
+        a.put(2 * i);
+        expectA.insert(2 * i);
+    }
+    for (int i = 0; i < 2000; i++){
+        b.put(3 * i);
+        expectB.insert(3 * i);
+    }
+    a.put(std::numeric_limits<int>::max());
+    expectA.insert(std::numeric_limits<int>::max());
+
+    std::vector<int> expected;
+    std::set_union(expectA.begin(), expectA.end(), expectB.begin(), expectB.end(), std::back_inserter(expected));
+    BOOST_CHECK(contents(set_union(a, b)) == std::set<int>(expected.begin(), expected.end()));
+
+    expected.clear();
+    std::set_intersection(expectA.begin(), expectA.end(), expectB.begin(), expectB.end(), std::back_inserter(expected));
+    BOOST_CHECK(contents(set_intersection(a, b)) == std::set<int>(expected.begin(), expected.end()));
+
+    expected.clear();
+    std::set_difference(expectA.begin(), expectA.end(), expectB.begin(), expectB.end(), std::back_inserter(expected));
+    BOOST_CHECK(contents(set_difference(a, b)) == std::set<int>(expected.begin(), expected.end()));
+
+    expected.clear();
+    std::set_difference(expectB.begin(), expectB.end(), expectA.begin(), expectA.end(), std::back_inserter(expected));
+    BOOST_CHECK(contents(set_difference(b, a)) == std::set<int>(expected.begin(), expected.end()));
+}
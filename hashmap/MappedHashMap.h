@@ -0,0 +1,419 @@
+/*
+ * Copyright (C) 2013 Christian Briones
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense, 
+ * and/or sell copies of the Software, and to permit persons to whom the 
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included 
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, 
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES 
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR
+ * ANY CLAIM, DAMAGES, OR OTHER LIABILITY, WHETHER IN AN ACTION OF
+ * CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+ * WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef MAPPED_HASH_MAP_H_
+#define MAPPED_HASH_MAP_H_
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdint.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+#if __cplusplus >= 201703L
+#include <string_view>
+#endif
+
+#include "Hash.h"
+#include "Group.h"
+#include "HashMap.h"
+
+/*
+ * Snapshot files: a HashMap written out as a ready-to-probe group table,
+ * which MappedHashMap serves straight from mapped pages.
+ *
+ * A snapshot is laid out as a header, the control bytes, the slots, and
+ * the bytes of any strings, each section starting on a cache line. Every
+ * position is an offset from the start of the file, so the file can be
+ * mapped anywhere and shared by any number of processes. Keys and values
+ * must be trivially copyable, or std::string (from C++17, where they are
+ * read back as string_views).
+ *
+ * The header records the hash seed the table was laid out with, so a
+ * snapshot stays readable whatever seed the reading process uses. It also
+ * records the group width, which depends on the instruction set the
+ * writer was built for; a reader built for another width rejects the
+ * file. Any change to the hash functions or the layout must bump VERSION.
+ */
+namespace snapshot_detail {
+    const uint64_t MAGIC = 0x50414e5350414d48ull; // "HMAPSNAP", little-endian
+    const uint32_t VERSION = 1;
+
+    struct Header {
+        uint64_t magic;
+        uint32_t version;
+        uint32_t groupWidth;
+        uint32_t keySize;   // Sizes of a stored key and value, which catch
+        uint32_t valueSize; // a reader instantiated with the wrong types
+        uint64_t seed;
+        uint64_t size;
+        uint64_t tableSize;
+        uint64_t ctrlOffset;
+        uint64_t slotsOffset;
+        uint64_t stringsOffset;
+        uint64_t fileSize;
+    };
+
+    inline uint64_t align(uint64_t offset){
+        return (offset + 63) & ~static_cast<uint64_t>(63);
+    }
+
+    /**
+     * How a key or value of type T is stored in a snapshot, and read back.
+     * Trivially copyable types are stored as they are.
+     */
+    template <class T>
+    struct Field {
+        static_assert(std::is_trivially_copyable<T>::value,
+                "snapshot keys and values must be trivially copyable or std::string");
+
+        typedef T Stored;
+        typedef T View;
+
+        static Stored store(const T& value, std::string&){
+            return value;
+        }
+        static View load(const Stored& stored, const char*){
+            return stored;
+        }
+        template <class K>
+        static bool equals(const Stored& stored, const char*, const K& key){
+            return stored == key;
+        }
+        static bool valid(const Stored&, uint64_t){
+            return true;
+        }
+    };
+
+#if __cplusplus >= 201703L
+    /**
+     * Strings are stored as the position of their bytes in the strings
+     * section.
+     */
+    struct StringRef {
+        uint64_t offset;
+        uint64_t size;
+    };
+
+    template <>
+    struct Field<std::string> {
+        typedef StringRef Stored;
+        typedef std::string_view View;
+
+        static Stored store(const std::string& value, std::string& strings){
+            Stored stored = { strings.size(), value.size() };
+            strings += value;
+            return stored;
+        }
+        static View load(const Stored& stored, const char* strings){
+            return View(strings + stored.offset, stored.size);
+        }
+        template <class K>
+        static bool equals(const Stored& stored, const char* strings, const K& key){
+            return load(stored, strings) == View(key);
+        }
+        // True if the string lies within a strings section of length bytes
+        static bool valid(const Stored& stored, uint64_t length){
+            return stored.offset <= length && stored.size <= length - stored.offset;
+        }
+    };
+#endif
+
+    template <class Key, class Value>
+    struct Slot {
+        typename Field<Key>::Stored key;
+        typename Field<Value>::Stored value;
+    };
+
+    inline void pad(std::ofstream& out, uint64_t from, uint64_t to){
+        static const char zeros[64] = {};
+        out.write(zeros, to - from);
+    }
+}
+
+/**
+ * Writes every pair in map to a snapshot file at path, which
+ * MappedHashMap can then map. The table is laid out with the given seed.
+ *
+ * The file is written under a temporary name and renamed over path once
+ * complete, so processes that still have an older snapshot at path mapped
+ * keep reading it undisturbed. Throws std::runtime_error if the file
+ * cannot be written.
+ */
+template <class Key, class Value>
+void write_snapshot(const HashMap<Key, Value>& map, const std::string& path, uint64_t seed = hash_seed()){
+    using namespace snapshot_detail;
+    typedef snapshot_detail::Slot<Key, Value> Slot;
+
+    // The table is never written to again, so it can be loaded up to 7/8
+    // like a dense in-memory table
+    int tableSize = table_capacity(static_cast<int>(map.size() + map.size() / 7 + 1));
+    int groups = tableSize / Group::WIDTH;
+    std::vector<int8_t> ctrl(tableSize, CTRL_EMPTY);
+    std::vector<Slot> slots(tableSize); // Zeroed, padding included
+    std::string strings;
+
+    Hash<Key> hashcode = hash_detail::make_hasher<Hash<Key> >(seed);
+    for (auto iter = map.begin(); iter != map.end(); ++iter){
+        auto pair = *iter;
+        size_t hash = mix_hash(hashcode(pair.first));
+
+        int g = h1(hash) & (groups - 1);
+        uint32_t free;
+        for (int n = 1; !(free = Group(&ctrl[g * Group::WIDTH]).match_empty()); n++){
+            g = (g + n) & (groups - 1);
+        }
+        int i = g * Group::WIDTH + lowest_bit(free);
+        ctrl[i] = h2(hash);
+        slots[i].key = Field<Key>::store(pair.first, strings);
+        slots[i].value = Field<Value>::store(pair.second, strings);
+    }
+
+    Header header = {};
+    header.magic = MAGIC;
+    header.version = VERSION;
+    header.groupWidth = Group::WIDTH;
+    header.keySize = sizeof(typename Field<Key>::Stored);
+    header.valueSize = sizeof(typename Field<Value>::Stored);
+    header.seed = seed;
+    header.size = map.size();
+    header.tableSize = tableSize;
+    header.ctrlOffset = align(sizeof(Header));
+    header.slotsOffset = align(header.ctrlOffset + tableSize);
+    header.stringsOffset = align(header.slotsOffset + tableSize * sizeof(Slot));
+    header.fileSize = header.stringsOffset + strings.size();
+
+    std::string temp = path + ".tmp";
+    std::ofstream out(temp, std::ios::binary | std::ios::trunc);
+    out.write(reinterpret_cast<const char*>(&header), sizeof(Header));
+    pad(out, sizeof(Header), header.ctrlOffset);
+    out.write(reinterpret_cast<const char*>(ctrl.data()), tableSize);
+    pad(out, header.ctrlOffset + tableSize, header.slotsOffset);
+    out.write(reinterpret_cast<const char*>(slots.data()), tableSize * sizeof(Slot));
+    pad(out, header.slotsOffset + tableSize * sizeof(Slot), header.stringsOffset);
+    out.write(strings.data(), strings.size());
+    out.close();
+
+    if (!out || std::rename(temp.c_str(), path.c_str()) != 0){
+        std::remove(temp.c_str());
+        throw std::runtime_error("could not write snapshot " + path);
+    }
+}
+
+/**
+ * Read-only hash table served from a memory-mapped snapshot file (see
+ * write_snapshot). Opening a snapshot only maps and checks its header,
+ * and for string keys or values reads the slots once to check that every
+ * string lies within the file; other pages are faulted in by the lookups
+ * that touch them, and are shared through the page cache with every other
+ * process mapping the same file.
+ *
+ * Lookups probe the mapped table exactly as HashMap probes its own. Values
+ * are returned as Field<Value>::View: a copy of a trivially copyable
+ * value, or a string_view into the mapping that is valid as long as the
+ * MappedHashMap is.
+ */
+template <class Key, class Value>
+class MappedHashMap {
+    template <class K>
+    using Lookup = typename std::enable_if<std::is_same<K, Key>::value || is_transparent<Hash<Key> >::value>::type;
+public:
+    typedef typename snapshot_detail::Field<Value>::View View;
+
+    explicit MappedHashMap(const std::string& path);
+    ~MappedHashMap();
+
+    MappedHashMap(const MappedHashMap<Key, Value>&) = delete;
+    MappedHashMap<Key, Value>& operator=(const MappedHashMap<Key, Value>&) = delete;
+
+    bool get(const Key& key, View& value) const {
+        return get<Key>(key, value);
+    }
+    bool contains(const Key& key) const {
+        return contains<Key>(key);
+    }
+
+    // Lookups by any type Hash<Key> is transparent for, without
+    // constructing a Key (see is_transparent in Hash.h)
+    template <class K, class = Lookup<K> >
+    bool get(const K& key, View& value) const;
+    template <class K, class = Lookup<K> >
+    bool contains(const K& key) const;
+
+    size_t size() const {
+        return header_->size;
+    }
+private:
+    typedef snapshot_detail::Slot<Key, Value> Slot;
+
+    template <class K>
+    const Slot* find(const K& key) const;
+
+    const char* data_ = nullptr;
+    size_t length_ = 0;
+    const snapshot_detail::Header* header_;
+    const int8_t* ctrl_;
+    const Slot* slots_;
+    const char* strings_;
+    int groups_;
+    Hash<Key> hashcode;
+};
+
+/**
+ * Maps the snapshot at path. Throws std::runtime_error if it cannot be
+ * mapped, is not a snapshot of this key and value type written for this
+ * group width, or is truncated or corrupt.
+ */
+template <class Key, class Value>
+MappedHashMap<Key, Value>::MappedHashMap(const std::string& path){
+    using namespace snapshot_detail;
+
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0){
+        throw std::runtime_error("could not open snapshot " + path + ": " + strerror(errno));
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || static_cast<size_t>(st.st_size) < sizeof(Header)){
+        close(fd);
+        throw std::runtime_error(path + ": not a snapshot");
+    }
+    length_ = st.st_size;
+    void* data = mmap(nullptr, length_, PROT_READ, MAP_SHARED, fd, 0);
+    int error = errno;
+    close(fd);
+    if (data == MAP_FAILED){
+        throw std::runtime_error("could not map snapshot " + path + ": " + strerror(error));
+    }
+    data_ = static_cast<const char*>(data);
+
+    header_ = reinterpret_cast<const Header*>(data_);
+    uint64_t tableSize = header_->tableSize;
+    const char* problem = nullptr;
+    if (header_->magic != MAGIC){
+        problem = "not a snapshot";
+    } else if (header_->version != VERSION){
+        problem = "unsupported snapshot version";
+    } else if (header_->groupWidth != Group::WIDTH){
+        problem = "written for a different group width";
+    } else if (header_->keySize != sizeof(typename Field<Key>::Stored) ||
+            header_->valueSize != sizeof(typename Field<Value>::Stored)){
+        problem = "written for different key or value types";
+    } else if (header_->fileSize != length_ || tableSize > length_ || tableSize < Group::WIDTH || (tableSize & (tableSize - 1)) ||
+            header_->ctrlOffset < sizeof(Header) ||
+            header_->slotsOffset < header_->ctrlOffset + tableSize ||
+            header_->stringsOffset < header_->slotsOffset + tableSize * sizeof(Slot) ||
+            header_->stringsOffset > length_){
+        problem = "truncated or corrupt";
+    } else {
+        // Lookups follow string offsets without checking them, so a bad
+        // one must not get past the open
+        const int8_t* ctrl = reinterpret_cast<const int8_t*>(data_ + header_->ctrlOffset);
+        const Slot* slots = reinterpret_cast<const Slot*>(data_ + header_->slotsOffset);
+        uint64_t strings = length_ - header_->stringsOffset;
+        for (uint64_t i = 0; i < tableSize; i++){
+            if (ctrl[i] >= 0 && (!Field<Key>::valid(slots[i].key, strings) ||
+                    !Field<Value>::valid(slots[i].value, strings))){
+                problem = "truncated or corrupt";
+                break;
+            }
+        }
+    }
+    if (problem){
+        munmap(data, length_);
+        throw std::runtime_error(path + ": " + problem);
+    }
+
+    ctrl_ = reinterpret_cast<const int8_t*>(data_ + header_->ctrlOffset);
+    slots_ = reinterpret_cast<const Slot*>(data_ + header_->slotsOffset);
+    strings_ = data_ + header_->stringsOffset;
+    groups_ = header_->tableSize / Group::WIDTH;
+    hashcode = hash_detail::make_hasher<Hash<Key> >(header_->seed);
+}
+
+template <class Key, class Value>
+MappedHashMap<Key, Value>::~MappedHashMap(){
+    munmap(const_cast<char*>(data_), length_);
+}
+
+/**
+ * Returns the slot holding key, or nullptr if it is not present.
+ */
+template <class Key, class Value>
+template <class K>
+const typename MappedHashMap<Key, Value>::Slot* MappedHashMap<Key, Value>::find(const K& key) const {
+    typedef snapshot_detail::Field<Key> KeyField;
+
+    size_t hash = mix_hash(hashcode(key));
+    int8_t fragment = h2(hash);
+    int g = h1(hash) & (groups_ - 1);
+
+    for (int n = 0; n < groups_; n++){
+        int base = g * Group::WIDTH;
+        Group group(&ctrl_[base]);
+
+        for (uint32_t match = group.match(fragment); match; match &= match - 1){
+            const Slot* slot = &slots_[base + lowest_bit(match)];
+            if (KeyField::equals(slot->key, strings_, key)){
+                return slot;
+            }
+        }
+        if (group.match_empty()){
+            return nullptr;
+        }
+        // Triangular probing visits every group of a power-of-two table
+        g = (g + n + 1) & (groups_ - 1);
+    }
+    return nullptr;
+}
+
+/**
+ * Stores the value at key in value and returns true, or returns false if
+ * the key is not present.
+ */
+template <class Key, class Value>
+template <class K, class>
+bool MappedHashMap<Key, Value>::get(const K& key, View& value) const {
+    const Slot* slot = find(key);
+    if (!slot){
+        return false;
+    }
+    value = snapshot_detail::Field<Value>::load(slot->value, strings_);
+    return true;
+}
+
+template <class Key, class Value>
+template <class K, class>
+bool MappedHashMap<Key, Value>::contains(const K& key) const {
+    return find(key) != nullptr;
+}
+
+#endif // MAPPED_HASH_MAP_H_
@@ -0,0 +1,117 @@
+#define BOOST_TEST_MODULE MappedHashMap test
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <boost/test/unit_test.hpp>
+
+#include "MappedHashMap.h"
+
+const char* PATH = "mapped_hash_map_test.snap";
+
+BOOST_AUTO_TEST_CASE(int_test){
+    HashMap<int, double> map;
+    const int TEST_SIZE = 10000;
+    for (int i = 0; i < TEST_SIZE; i++){
+        map.put(i, i / 2.0);
+    }
+    write_snapshot(map, PATH);
+
+    // The file carries the seed it was laid out with
+    uint64_t seed = hash_seed();
+    set_hash_seed(seed + 1);
+    MappedHashMap<int, double> mapped(PATH);
+    set_hash_seed(seed);
+
+    BOOST_CHECK_EQUAL(mapped.size(), TEST_SIZE);
+    for (int i = 0; i < TEST_SIZE; i++){
+        double value = -1;
+        BOOST_REQUIRE(mapped.get(i, value));
+        BOOST_CHECK_EQUAL(value, i / 2.0);
+    }
+    double value = -1;
+    BOOST_CHECK(!mapped.get(TEST_SIZE, value));
+    BOOST_CHECK(!mapped.contains(-1));
+    std::remove(PATH);
+}
+
+BOOST_AUTO_TEST_CASE(empty_test){
+    write_snapshot(HashMap<int, int>(), PATH);
+
+    MappedHashMap<int, int> mapped(PATH);
+    BOOST_CHECK_EQUAL(mapped.size(), 0);
+    BOOST_CHECK(!mapped.contains(0));
+    std::remove(PATH);
+}
+
+#if __cplusplus >= 201703L
+BOOST_AUTO_TEST_CASE(string_test){
+    HashMap<std::string, std::string> map = { {"Doggy", "woof"}, {"Cat", "meow"}, {"Frog", ""} };
+    for (int i = 0; i < 1000; i++){
+        map.put("key" + std::to_string(i), std::string(i % 50, 'x'));
+    }
+    write_snapshot(map, PATH);
+
+    MappedHashMap<std::string, std::string> mapped(PATH);
+    BOOST_CHECK_EQUAL(mapped.size(), map.size());
+
+    std::string_view value;
+    BOOST_REQUIRE(mapped.get("Cat", value));
+    BOOST_CHECK_EQUAL(value, "meow");
+    BOOST_REQUIRE(mapped.get(std::string("Frog"), value));
+    BOOST_CHECK(value.empty());
+    BOOST_CHECK(mapped.contains(std::string_view("key999")));
+    BOOST_CHECK(!mapped.contains("Giraffe"));
+    for (int i = 0; i < 1000; i++){
+        BOOST_REQUIRE(mapped.get("key" + std::to_string(i), value));
+        BOOST_CHECK_EQUAL(value.size(), i % 50);
+    }
+    std::remove(PATH);
+}
+
+BOOST_AUTO_TEST_CASE(corrupt_string_test){
+    typedef snapshot_detail::Slot<std::string, std::string> Slot;
+    HashMap<std::string, std::string> map = { {"Doggy", "woof"}, {"Cat", "meow"} };
+    write_snapshot(map, PATH);
+
+    // Point the first stored value past the end of the file
+    snapshot_detail::Header header;
+    std::fstream file(PATH, std::ios::in | std::ios::out | std::ios::binary);
+    file.read(reinterpret_cast<char*>(&header), sizeof(header));
+    std::vector<char> ctrl(header.tableSize);
+    file.seekg(header.ctrlOffset);
+    file.read(ctrl.data(), ctrl.size());
+    uint64_t i = std::find_if(ctrl.begin(), ctrl.end(), [](char c){ return c >= 0; }) - ctrl.begin();
+    BOOST_REQUIRE_LT(i, header.tableSize);
+
+    Slot slot;
+    file.seekg(header.slotsOffset + i * sizeof(Slot));
+    file.read(reinterpret_cast<char*>(&slot), sizeof(Slot));
+    slot.value.size = header.fileSize;
+    file.seekp(header.slotsOffset + i * sizeof(Slot));
+    file.write(reinterpret_cast<const char*>(&slot), sizeof(Slot));
+    file.close();
+
+    BOOST_CHECK_THROW((MappedHashMap<std::string, std::string>(PATH)), std::runtime_error);
+    std::remove(PATH);
+}
+#endif
+
+BOOST_AUTO_TEST_CASE(reject_test){
+    BOOST_CHECK_THROW((MappedHashMap<int, int>("no/such/file")), std::runtime_error);
+
+    {
+        std::ofstream out(PATH);
+        out << "not a snapshot, though long enough to hold a header";
+    }
+    BOOST_CHECK_THROW((MappedHashMap<int, int>(PATH)), std::runtime_error);
+
+    HashMap<int, int> map = { {1, 2} };
+    write_snapshot(map, PATH);
+    BOOST_CHECK_THROW((MappedHashMap<int, long>(PATH)), std::runtime_error);
+    BOOST_CHECK_NO_THROW((MappedHashMap<int, int>(PATH)));
+    std::remove(PATH);
+}
@@ -0,0 +1,393 @@
+/*
+ * Copyright (C) 2013 Christian Briones
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense, 
+ * and/or sell copies of the Software, and to permit persons to whom the 
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included 
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, 
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES 
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR
+ * ANY CLAIM, DAMAGES, OR OTHER LIABILITY, WHETHER IN AN ACTION OF
+ * CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+ * WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef ROBIN_HOOD_MAP_H_
+#define ROBIN_HOOD_MAP_H_
+
+#include <vector>
+#include <memory>
+#include <new>
+#include <utility>
+#include <stdint.h>
+
+#include <initializer_list>
+
+#include "Hash.h"
+#include "HashMap.h"
+
+/**
+ * Hash Table container class implemented with Robin Hood linear probing.
+ *
+ * Each slot records how far its pair sits from its home slot. On insert a
+ * pair that has probed further than the occupant of a slot takes that slot,
+ * and the occupant continues probing in its place. This keeps probe lengths
+ * short and uniform even at high load.
+ *
+ * Removal shifts the rest of the cluster back by one slot instead of
+ * leaving a tombstone, so the table never degrades under churn.
+ *
+ * The interface mirrors HashMap.
+ */
+template <typename Key, typename Value>
+class RobinHoodMap {
+public:
+    RobinHoodMap();
+    RobinHoodMap(std::initializer_list<Pair<const Key&, const Value&> > list);
+    RobinHoodMap(const RobinHoodMap<Key, Value>& other);
+    RobinHoodMap<Key, Value>& operator=(const RobinHoodMap<Key, Value>& other);
+    ~RobinHoodMap();
+
+    void put(const Key& key, const Value& value);
+    void put(Pair<const Key&, const Value&> pair);
+    Value& get(const Key& key);
+    void remove(const Key& key);
+
+    bool contains(const Key& key) const;
+
+    float max_load() const {
+        return maxLoad_;
+    }
+    void set_max_load(float maxLoad){
+        maxLoad_ = maxLoad;
+    }
+    Value& operator[](const Key& key){
+        return get(key);
+    }
+    size_t size() const;
+
+    class Iterator;
+    Iterator begin() const;
+    Iterator end() const;
+private:
+    typedef Pair<Key, Value> Slot;
+
+    int size_ = 0; // Number of key-value pairs
+    int tableSize_ = 64; // size of probing table, always a power of two
+
+    float maxLoad_ = 0.75;
+    void resize(int newSize);
+    int find(const Key& key) const;
+    int insert(Slot&& slot);
+    void destroy();
+
+    int home(const Key& key) const {
+        return mix_hash(hashcode(key)) & (tableSize_ - 1);
+    }
+
+    Hash<Key> hashcode;
+    std::allocator<Slot> alloc_;
+    Slot* slots_ = nullptr; // Uninitialized except where dist_ is non-zero
+    std::vector<int32_t> dist_; // 0 if empty, otherwise 1 + probe distance
+};
+
+template <class Key, class Value>
+RobinHoodMap<Key, Value>::RobinHoodMap() : slots_(alloc_.allocate(tableSize_)), dist_(tableSize_, 0) {}
+
+template <class Key, class Value>
+RobinHoodMap<Key, Value>::RobinHoodMap(std::initializer_list<Pair<const Key&, const Value&> > list) : RobinHoodMap() {
+    for (auto& x : list){
+        put(x.first, x.second);
+    }
+}
+
+template <class Key, class Value>
+RobinHoodMap<Key, Value>::RobinHoodMap(const RobinHoodMap<Key, Value>& other) :
+    size_(other.size_),
+    tableSize_(other.tableSize_),
+    maxLoad_(other.maxLoad_),
+    hashcode(other.hashcode),
+    slots_(alloc_.allocate(other.tableSize_)),
+    dist_(other.dist_)
+{
+    for (int i = 0; i < tableSize_; i++){
+        if (dist_[i]){
+            new (&slots_[i]) Slot(other.slots_[i]);
+        }
+    }
+}
+
+template <class Key, class Value>
+RobinHoodMap<Key, Value>& RobinHoodMap<Key, Value>::operator=(const RobinHoodMap<Key, Value>& other){
+    if (this != &other){
+        RobinHoodMap<Key, Value> copy(other);
+        destroy();
+
+        size_ = copy.size_;
+        tableSize_ = copy.tableSize_;
+        maxLoad_ = copy.maxLoad_;
+        hashcode = copy.hashcode;
+        slots_ = copy.slots_;
+        dist_.swap(copy.dist_);
+
+        // Leave the copy empty so its destructor releases nothing
+        copy.slots_ = nullptr;
+        copy.tableSize_ = 0;
+    }
+    return *this;
+}
+
+template <class Key, class Value>
+RobinHoodMap<Key, Value>::~RobinHoodMap(){
+    destroy();
+}
+
+/**
+ * Destroys every stored pair and releases the slot array.
+ */
+template <class Key, class Value>
+void RobinHoodMap<Key, Value>::destroy(){
+    for (int i = 0; i < tableSize_; i++){
+        if (dist_[i]){
+            slots_[i].~Slot();
+        }
+    }
+    if (slots_){
+        alloc_.deallocate(slots_, tableSize_);
+    }
+    slots_ = nullptr;
+}
+
+/**
+ * Returns the index of the slot holding key, or -1 if it is not present.
+ *
+ * The probe stops as soon as it reaches a slot whose occupant is closer to
+ * home than the key would be, since an insert of key would have taken it.
+ */
+template <class Key, class Value>
+int RobinHoodMap<Key, Value>::find(const Key& key) const {
+    int mask = tableSize_ - 1;
+    int i = home(key);
+    for (int d = 1; dist_[i] >= d; d++, i = (i + 1) & mask){
+        if (dist_[i] == d && slots_[i].first == key){
+            return i;
+        }
+    }
+    return -1;
+}
+
+/**
+ * Inserts a pair whose key is known not to be in the map, displacing
+ * richer occupants along the way. Returns the index the pair ends up in.
+ */
+template <class Key, class Value>
+int RobinHoodMap<Key, Value>::insert(Slot&& slot){
+    int mask = tableSize_ - 1;
+    int i = home(slot.first);
+    int placed = -1;
+
+    Slot carry(std::move(slot));
+    for (int d = 1; ; d++, i = (i + 1) & mask){
+        if (!dist_[i]){
+            new (&slots_[i]) Slot(std::move(carry));
+            dist_[i] = d;
+            return placed < 0 ? i : placed;
+        }
+        if (dist_[i] < d){
+            // Take from the rich
+            std::swap(carry, slots_[i]);
+            int richer = dist_[i];
+            dist_[i] = d;
+            d = richer;
+            if (placed < 0){
+                placed = i;
+            }
+        }
+    }
+}
+
+/**
+ * Inserts the key-value pair into the RobinHoodMap.
+ */
+template <class Key, class Value>
+void RobinHoodMap<Key, Value>::put(const Key& key, const Value& value){
+    int i = find(key);
+    if (i >= 0){
+        slots_[i].second = value;
+        return;
+    }
+    if (size_ + 1 > static_cast<int>(tableSize_ * maxLoad_)){
+        resize(tableSize_ * 2);
+    }
+    insert(Slot(key, value));
+    size_++;
+}
+
+/**
+ * Overloaded method for inserting pairs.
+ */
+template <class Key, class Value>
+void RobinHoodMap<Key, Value>::put(Pair<const Key&, const Value&> pair){
+    put(pair.first, pair.second);
+}
+
+/** 
+ * Returns a reference to the value in the RobinHoodMap at key.
+ * Creates a new pair if not in the map.
+ */
+template <class Key, class Value>
+Value& RobinHoodMap<Key, Value>::get(const Key& key){
+    int i = find(key);
+    if (i < 0){
+        if (size_ + 1 > static_cast<int>(tableSize_ * maxLoad_)){
+            resize(tableSize_ * 2);
+        }
+        i = insert(Slot(key, Value()));
+        size_++;
+    }
+    return slots_[i].second;
+}
+
+/**
+ * Returns true if the key is contained in the RobinHoodMap.
+ */
+template <class Key, class Value>
+bool RobinHoodMap<Key, Value>::contains(const Key& key) const {
+    return find(key) >= 0;
+}
+
+/*
+ * Removes a key-value pair from the RobinHoodMap. Every following pair in
+ * the cluster that is not already in its home slot moves back one slot,
+ * so no tombstone is needed.
+ */
+template <class Key, class Value>
+void RobinHoodMap<Key, Value>::remove(const Key& key) {
+    int i = find(key);
+    if (i < 0){
+        return;
+    }
+    int mask = tableSize_ - 1;
+
+    slots_[i].~Slot();
+    for (int next = (i + 1) & mask; dist_[next] > 1; i = next, next = (next + 1) & mask){
+        new (&slots_[i]) Slot(std::move(slots_[next]));
+        slots_[next].~Slot();
+        dist_[i] = dist_[next] - 1;
+    }
+    dist_[i] = 0;
+    size_--;
+}
+
+template <class Key, class Value>
+inline size_t RobinHoodMap<Key, Value>::size() const {
+    return size_;
+}
+
+/** 
+ * Resizes the RobinHoodMap and rehashes all of the key-value pairs into
+ * new locations.
+ */
+template <class Key, class Value>
+void RobinHoodMap<Key, Value>::resize(int newSize){
+    Slot* oldSlots = slots_;
+    std::vector<int32_t> oldDist(newSize, 0);
+    oldDist.swap(dist_);
+    int oldSize = tableSize_;
+
+    slots_ = alloc_.allocate(newSize);
+    tableSize_ = newSize;
+
+    for (int j = 0; j < oldSize; j++){
+        if (oldDist[j]){
+            insert(std::move(oldSlots[j]));
+            oldSlots[j].~Slot();
+        }
+    }
+    alloc_.deallocate(oldSlots, oldSize);
+}
+
+template <class Key, class Value>
+typename RobinHoodMap<Key, Value>::Iterator RobinHoodMap<Key, Value>::begin() const {
+    return Iterator(this, 0);
+}
+
+template <class Key, class Value>
+typename RobinHoodMap<Key, Value>::Iterator RobinHoodMap<Key, Value>::end() const {
+    Iterator iter(this, tableSize_);
+
+    return iter;
+}
+
+/**
+ * An iterator class for accessing the elements
+ * of the RobinHoodMap in no particular order.
+ *
+ * It is the responsibility of the client to no longer use an iterator
+ * after the map has been altered or destroyed.
+ *
+ * Dereferencing an iterator that points to the end of the container
+ * results in undefined behaivour.
+ */
+template <class Key, class Value>
+class RobinHoodMap<Key, Value>::Iterator {
+public:
+    Iterator(const RobinHoodMap<Key, Value>* map, int counter) : map_(map), counter_(counter) {
+        // Find the first full slot in the table
+        skip();
+    }
+
+    Iterator& operator++(){
+        increment();
+        return *this;
+    }
+    Iterator operator++(int){
+        Iterator old(*this);
+        increment();
+        return old;
+    }
+    bool operator==(const Iterator& other){
+        return other.map_ == map_ && other.counter_ == counter_;
+    }
+    bool operator!=(const Iterator& other){
+        return other.map_ != map_ || other.counter_ != counter_;
+    }
+    Pair<const Key&, Value&> operator*(){
+        auto& slot = map_->slots_[counter_];
+        return Pair<const Key&, Value&>(slot.first, slot.second);
+    }
+private:
+    const RobinHoodMap<Key, Value>* map_;
+    size_t counter_ = 0;
+
+    /**
+     * Advances the counter until we have a full slot
+     * or reach the end.
+     */
+    void skip(){
+        size_t tableSize = map_->tableSize_;
+        while (counter_ < tableSize && !map_->dist_[counter_]){
+            counter_++;
+        }
+    }
+
+    /** 
+     * Guarantees the counter moves at least once,
+     * then continues until we have a full slot
+     * or reach the end.
+     */
+    void increment(){
+        counter_++;
+        skip();
+    }
+};
+
+#endif // ROBIN_HOOD_MAP_H_
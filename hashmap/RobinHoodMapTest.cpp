@@ -0,0 +1,80 @@
+#define BOOST_TEST_MODULE RobinHoodMap test
+#include <iostream>
+#include <string>
+#include <vector>
+#include <map>
+#include <cstdlib>
+
+#include <boost/test/unit_test.hpp>
+
+#include "RobinHoodMap.h"
+
+BOOST_AUTO_TEST_CASE(ctor_test){
+    RobinHoodMap<std::string, int> map = { {"Doggy", 15}, {"Cat", 10}, {"Frog", 20} };
+
+    BOOST_CHECK_EQUAL(map.size(), 3);
+    BOOST_CHECK_EQUAL(map.get("Frog"), 20);
+
+    RobinHoodMap<std::string, int> copy;
+    copy = map;
+    copy.remove("Frog");
+
+    BOOST_CHECK(!copy.contains("Frog"));
+    BOOST_CHECK(map.contains("Frog"));
+}
+
+BOOST_AUTO_TEST_CASE(duplicate_test){
+    RobinHoodMap<std::string, int> map;
+
+    map.put("Cat", 1);
+    map.put("Cat", 2);
+    map["Dog"] = 3;
+
+    BOOST_CHECK_EQUAL(map.size(), 2);
+    BOOST_CHECK_EQUAL(map.get("Cat"), 2);
+    BOOST_CHECK_EQUAL(map.get("Dog"), 3);
+}
+
+BOOST_AUTO_TEST_CASE(iteration_test){
+    const int TEST_SIZE = 100;
+
+    RobinHoodMap<int, int> map;
+    BOOST_CHECK(map.begin() == map.end());
+
+    for (int i = 0; i < TEST_SIZE; i++){
+        map.put(i, -i);
+    }
+
+    int count = 0;
+    for (auto iter = map.begin(); iter != map.end(); iter++){
+        BOOST_CHECK_EQUAL((*iter).second, -(*iter).first);
+        count++;
+    }
+    BOOST_CHECK_EQUAL(count, TEST_SIZE);
+}
+
+BOOST_AUTO_TEST_CASE(churn_test){
+    // Random inserts and removals checked against std::map
+    RobinHoodMap<int, int> map;
+    std::map<int, int> expected;
+
+    srand(7);
+    for (int n = 0; n < 20000; n++){
+        int key = rand() % 2000;
+        if (rand() % 3 == 0){
+            map.remove(key);
+            expected.erase(key);
+        } else {
+            map.put(key, n);
+            expected[key] = n;
+        }
+    }
+
+    BOOST_CHECK_EQUAL(map.size(), expected.size());
+    for (int key = 0; key < 2000; key++){
+        BOOST_CHECK_EQUAL(map.contains(key), expected.count(key) == 1);
+        if (expected.count(key)){
+            BOOST_CHECK_EQUAL(map.get(key), expected[key]);
+        }
+    }
+}
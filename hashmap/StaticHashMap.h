@@ -0,0 +1,322 @@
+/*
+ * Copyright (C) 2013 Christian Briones
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense, 
+ * and/or sell copies of the Software, and to permit persons to whom the 
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included 
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, 
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES 
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR
+ * ANY CLAIM, DAMAGES, OR OTHER LIABILITY, WHETHER IN AN ACTION OF
+ * CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+ * WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef STATIC_HASH_MAP_H_
+#define STATIC_HASH_MAP_H_
+
+#include <stdint.h>
+
+#include <algorithm>
+#include <initializer_list>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "Hash.h"
+#include "HashMap.h"
+
+/**
+ * Immutable hash table built once from a set of pairs, using a minimal
+ * perfect hash: every key has a slot of its own, in a table of exactly as
+ * many slots as there are keys, and a lookup looks at that one slot.
+ *
+ * The perfect hash is built by hash-and-displace (as in CHD and PTHash).
+ * Keys are split into buckets of about BUCKET_SIZE keys by their hash.
+ * Each bucket gets a pilot, found by trying 0, 1, 2, ... until the hashes
+ * of the bucket's keys combined with it land on positions no earlier
+ * bucket took. Buckets are placed largest first, while most positions are
+ * still free.
+ *
+ * Finding room for the last buckets gets slow as the free positions run
+ * out, so there are a few more positions than keys (1 + 1 / SPARE times
+ * as many). Keys placed past the last slot are then remapped onto the
+ * slots that were left free, through a table of n / SPARE entries. A
+ * lookup hashes the key once, reads its bucket's pilot and goes straight
+ * to its slot, at a cost of 32 / BUCKET_SIZE bits per key for the pilots.
+ *
+ * If two keys hash to the same 64-bit value no pilot can separate them,
+ * so the build starts over with another seed. A key given more than once
+ * keeps its last value, as with HashMap::put.
+ */
+template <class Key, class Value>
+class StaticHashMap {
+    template <class K>
+    using Lookup = typename std::enable_if<std::is_same<K, Key>::value || is_transparent<Hash<Key> >::value>::type;
+public:
+    typedef Pair<Key, Value> Slot;
+    typedef typename std::vector<Slot>::const_iterator Iterator;
+
+    StaticHashMap(){}
+    StaticHashMap(std::initializer_list<Pair<const Key&, const Value&> > list){
+        build(list.begin(), list.end(), list.size());
+    }
+    explicit StaticHashMap(const HashMap<Key, Value>& map){
+        build(map.begin(), map.end(), map.size());
+    }
+    template <class Iter>
+    StaticHashMap(Iter first, Iter last){
+        build(first, last);
+    }
+
+    const Value& get(const Key& key) const {
+        return get<Key>(key);
+    }
+    const Value* find(const Key& key) const {
+        return find<Key>(key);
+    }
+    bool contains(const Key& key) const {
+        return contains<Key>(key);
+    }
+
+    // Lookups by any type Hash<Key> is transparent for, without
+    // constructing a Key (see is_transparent in Hash.h)
+    template <class K, class = Lookup<K> >
+    const Value& get(const K& key) const;
+    template <class K, class = Lookup<K> >
+    const Value* find(const K& key) const;
+    template <class K, class = Lookup<K> >
+    bool contains(const K& key) const {
+        return find(key) != nullptr;
+    }
+
+    size_t size() const {
+        return slots_.size();
+    }
+
+    Iterator begin() const {
+        return slots_.begin();
+    }
+    Iterator end() const {
+        return slots_.end();
+    }
+private:
+    static const int BUCKET_SIZE = 4;
+    static const int SPARE = 64;
+
+    // Pilots tried per bucket, and seeds tried per build, before giving up
+    static const uint32_t MAX_PILOT = 1u << 24;
+    static const int MAX_ATTEMPTS = 16;
+
+    template <class Iter>
+    void build(Iter first, Iter last, size_t hint = 0);
+    bool place(std::vector<Slot>& pairs, uint64_t seed);
+
+    /**
+     * Maps hash onto [0, n) by the high half of their product, which is
+     * cheaper than a modulo and uses the well-mixed high bits.
+     */
+    static size_t reduce(uint64_t hash, size_t n){
+        return static_cast<size_t>((static_cast<__uint128_t>(hash) * n) >> 64);
+    }
+    /**
+     * Returns the bucket of hash. As in PTHash, 60% of keys go to the
+     * first 30% of buckets. The crowded buckets are placed first, while
+     * the table is nearly empty, which leaves mostly small buckets for
+     * when it is nearly full.
+     */
+    static size_t bucket(uint64_t hash, size_t buckets){
+        size_t dense = buckets * 3 / 10;
+        if ((hash & 0xff) < 154){
+            return reduce(hash, dense);
+        }
+        return dense + reduce(hash, buckets - dense);
+    }
+    size_t slot(uint64_t hash, uint32_t pilot) const {
+        size_t p = reduce(hash_combine(hash, pilot), positions_);
+        return p < slots_.size() ? p : remap_[p - slots_.size()];
+    }
+
+    Hash<Key> hashcode;
+    std::vector<uint32_t> pilots_;
+    std::vector<uint32_t> remap_; // Slot of each position past the last
+    std::vector<Slot> slots_;
+    size_t positions_ = 0;
+};
+
+/**
+ * Builds the table from the pairs in [first, last), which may be any
+ * objects with first and second members, such as the pairs of a HashMap.
+ * hint, if given, is the number of pairs.
+ * Throws std::runtime_error if no perfect hash is found, which only
+ * happens if Hash<Key> maps distinct keys to the same value whatever the
+ * seed.
+ */
+template <class Key, class Value>
+template <class Iter>
+void StaticHashMap<Key, Value>::build(Iter first, Iter last, size_t hint){
+    std::vector<Slot> pairs;
+    pairs.reserve(hint);
+    for (; first != last; ++first){
+        pairs.push_back(Slot(InPlace(), (*first).first, (*first).second));
+    }
+
+    for (int attempt = 0; attempt < MAX_ATTEMPTS; attempt++){
+        uint64_t seed = attempt == 0 ? hash_seed() : hash_int(attempt, hash_seed());
+        if (place(pairs, seed)){
+            return;
+        }
+    }
+    throw std::runtime_error("StaticHashMap: could not build a perfect hash");
+}
+
+/**
+ * Tries to build the perfect hash with the given seed, and moves the pairs
+ * into their slots if it succeeds. Returns false, leaving pairs untouched,
+ * if two keys have the same hash or some bucket runs out of pilots.
+ */
+template <class Key, class Value>
+bool StaticHashMap<Key, Value>::place(std::vector<Slot>& pairs, uint64_t seed){
+    hashcode = hash_detail::make_hasher<Hash<Key> >(seed);
+
+    size_t buckets = (pairs.size() + BUCKET_SIZE - 1) / BUCKET_SIZE;
+    std::vector<uint64_t> hashes(pairs.size());
+    std::vector<size_t> starts(buckets + 1, 0);
+    for (size_t i = 0; i < pairs.size(); i++){
+        hashes[i] = mix_hash(hashcode(pairs[i].first));
+        starts[bucket(hashes[i], buckets) + 1]++;
+    }
+    // Group the keys by bucket, and order each bucket by hash so that
+    // repeated keys and colliding hashes end up next to each other
+    for (size_t b = 0; b < buckets; b++){
+        starts[b + 1] += starts[b];
+    }
+    std::vector<size_t> order(pairs.size());
+    std::vector<size_t> next(starts.begin(), starts.end() - 1);
+    for (size_t i = 0; i < pairs.size(); i++){
+        order[next[bucket(hashes[i], buckets)]++] = i;
+    }
+
+    // Drop all but the last of any repeated key
+    size_t n = 0;
+    std::vector<std::pair<size_t, size_t> > ranges(buckets); // Start and end in order
+    for (size_t b = 0; b < buckets; b++){
+        std::sort(order.begin() + starts[b], order.begin() + starts[b + 1], [&](size_t x, size_t y){
+            return hashes[x] < hashes[y] || (hashes[x] == hashes[y] && x < y);
+        });
+        ranges[b].first = n;
+        for (size_t k = starts[b]; k < starts[b + 1]; k++){
+            if (k + 1 < starts[b + 1] && hashes[order[k]] == hashes[order[k + 1]]){
+                if (!(pairs[order[k]].first == pairs[order[k + 1]].first)){
+                    return false;
+                }
+                continue;
+            }
+            order[n++] = order[k];
+        }
+        ranges[b].second = n;
+    }
+
+    std::vector<size_t> byBucketSize(buckets);
+    for (size_t b = 0; b < buckets; b++){
+        byBucketSize[b] = b;
+    }
+    std::stable_sort(byBucketSize.begin(), byBucketSize.end(), [&](size_t x, size_t y){
+        return ranges[x].second - ranges[x].first > ranges[y].second - ranges[y].first;
+    });
+
+    size_t positions = n + n / SPARE;
+    std::vector<uint32_t> pilots(buckets, 0);
+    std::vector<uint64_t> used((positions + 63) / 64, 0); // One bit per position, kept small
+    std::vector<size_t> owner(positions, SIZE_MAX); // Index into pairs of each position's key
+    std::vector<size_t> taken; // Positions of the bucket being placed
+    for (size_t b : byBucketSize){
+        size_t start = ranges[b].first, end = ranges[b].second;
+        if (start == end){
+            break;
+        }
+        uint32_t pilot = 0;
+        for (;; pilot++){
+            if (pilot == MAX_PILOT){
+                return false;
+            }
+            taken.clear();
+            bool fits = true;
+            for (size_t k = start; k < end && fits; k++){
+                size_t p = reduce(hash_combine(hashes[order[k]], pilot), positions);
+                fits = !(used[p / 64] >> (p % 64) & 1) && std::find(taken.begin(), taken.end(), p) == taken.end();
+                taken.push_back(p);
+            }
+            if (fits){
+                break;
+            }
+        }
+        for (size_t k = start; k < end; k++){
+            used[taken[k - start] / 64] |= static_cast<uint64_t>(1) << (taken[k - start] % 64);
+            owner[taken[k - start]] = order[k];
+        }
+        pilots[b] = pilot;
+    }
+
+    // Move the keys past the last slot into the free slots, in order
+    std::vector<uint32_t> remap(positions - n);
+    for (size_t p = n, free = 0; p < positions; p++){
+        if (owner[p] != SIZE_MAX){
+            while (owner[free] != SIZE_MAX){
+                free++;
+            }
+            owner[free] = owner[p];
+            remap[p - n] = free;
+        }
+    }
+
+    slots_.clear();
+    slots_.reserve(n);
+    for (size_t p = 0; p < n; p++){
+        slots_.push_back(std::move(pairs[owner[p]]));
+    }
+    pilots_.swap(pilots);
+    remap_.swap(remap);
+    positions_ = positions;
+    return true;
+}
+
+/**
+ * Returns a pointer to the value at key, or nullptr if the key is not
+ * present.
+ */
+template <class Key, class Value>
+template <class K, class>
+const Value* StaticHashMap<Key, Value>::find(const K& key) const {
+    if (slots_.empty()){
+        return nullptr;
+    }
+    uint64_t hash = mix_hash(hashcode(key));
+    const Slot& candidate = slots_[slot(hash, pilots_[bucket(hash, pilots_.size())])];
+    return candidate.first == key ? &candidate.second : nullptr;
+}
+
+/**
+ * Returns a reference to the value at key. Throws std::out_of_range if the
+ * key is not present.
+ */
+template <class Key, class Value>
+template <class K, class>
+const Value& StaticHashMap<Key, Value>::get(const K& key) const {
+    const Value* value = find(key);
+    if (!value){
+        throw std::out_of_range("StaticHashMap: key not present");
+    }
+    return *value;
+}
+
+#endif // STATIC_HASH_MAP_H_
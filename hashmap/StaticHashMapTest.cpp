@@ -0,0 +1,62 @@
+#define BOOST_TEST_MODULE StaticHashMap test
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <boost/test/unit_test.hpp>
+
+#include "StaticHashMap.h"
+
+BOOST_AUTO_TEST_CASE(ctor_test){
+    StaticHashMap<std::string, int> empty;
+    BOOST_CHECK_EQUAL(empty.size(), 0);
+    BOOST_CHECK(!empty.contains("Cat"));
+    BOOST_CHECK(empty.begin() == empty.end());
+
+    StaticHashMap<std::string, int> map = { {"Doggy", 15}, {"Cat", 10}, {"Frog", 20} };
+    BOOST_CHECK_EQUAL(map.size(), 3);
+    BOOST_CHECK_EQUAL(map.get("Cat"), 10);
+    BOOST_CHECK(!map.contains("Giraffe"));
+    BOOST_CHECK_THROW(map.get("Giraffe"), std::out_of_range);
+}
+
+BOOST_AUTO_TEST_CASE(lookup_test){
+    const int TEST_SIZE = 100000;
+    HashMap<int, int> source;
+    for (int i = 0; i < TEST_SIZE; i++){
+        source.put(3 * i, i);
+    }
+    StaticHashMap<int, int> map(source);
+
+    BOOST_CHECK_EQUAL(map.size(), TEST_SIZE);
+    for (int i = 0; i < 3 * TEST_SIZE; i++){
+        const int* value = map.find(i);
+        if (i % 3 == 0){
+            BOOST_REQUIRE(value);
+            BOOST_CHECK_EQUAL(*value, i / 3);
+        } else {
+            BOOST_CHECK(!value);
+        }
+    }
+
+    // Every slot holds a key
+    int count = 0;
+    for (auto iter = map.begin(); iter != map.end(); ++iter){
+        BOOST_CHECK_EQUAL(iter->first, 3 * iter->second);
+        count++;
+    }
+    BOOST_CHECK_EQUAL(count, TEST_SIZE);
+}
+
+BOOST_AUTO_TEST_CASE(duplicate_test){
+    std::vector<Pair<std::string, int> > pairs = {
+        create_pair(std::string("Cat"), 1),
+        create_pair(std::string("Dog"), 2),
+        create_pair(std::string("Cat"), 3)
+    };
+    StaticHashMap<std::string, int> map(pairs.begin(), pairs.end());
+
+    BOOST_CHECK_EQUAL(map.size(), 2);
+    BOOST_CHECK_EQUAL(map.get("Cat"), 3);
+    BOOST_CHECK_EQUAL(map.get(std::string("Dog")), 2);
+}
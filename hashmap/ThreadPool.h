@@ -0,0 +1,175 @@
+/*
+ * Copyright (C) 2013 Christian Briones
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense, 
+ * and/or sell copies of the Software, and to permit persons to whom the 
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included 
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, 
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES 
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR
+ * ANY CLAIM, DAMAGES, OR OTHER LIABILITY, WHETHER IN AN ACTION OF
+ * CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+ * WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef THREAD_POOL_H_
+#define THREAD_POOL_H_
+
+#include <stddef.h>
+
+#include <atomic>
+#include <condition_variable>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/**
+ * Fixed set of worker threads for the parallel container operations.
+ *
+ * run(n, task) calls task(0) ... task(n - 1), handing the indices out to
+ * the workers and the calling thread as each becomes free, and returns
+ * once they have all finished. Calls to run from different threads take
+ * turns; a task must not call run on its own pool.
+ */
+class ThreadPool {
+public:
+    explicit ThreadPool(int threads = std::thread::hardware_concurrency());
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    /**
+     * Number of threads that run tasks, counting the caller of run.
+     */
+    int size() const {
+        return static_cast<int>(workers_.size()) + 1;
+    }
+
+    void run(size_t n, std::function<void(size_t)> task);
+
+    /**
+     * A pool with a thread per core, shared by every caller that does not
+     * bring its own.
+     */
+    static ThreadPool& shared(){
+        static ThreadPool pool;
+        return pool;
+    }
+private:
+    void work();
+    void drain();
+
+    std::vector<std::thread> workers_;
+    std::mutex runLock_; // Held for the whole of a run
+
+    std::mutex lock_;
+    std::condition_variable wake_;
+    std::condition_variable finished_;
+    std::function<void(size_t)> task_;
+    size_t count_ = 0;
+    std::atomic<size_t> next_;
+    size_t done_ = 0;
+    int active_ = 0; // Workers inside drain, which a run waits out
+    unsigned long generation_ = 0;
+    bool stop_ = false;
+    std::exception_ptr error_;
+};
+
+inline ThreadPool::ThreadPool(int threads) : next_(0) {
+    for (int i = 1; i < threads; i++){
+        workers_.emplace_back(&ThreadPool::work, this);
+    }
+}
+
+inline ThreadPool::~ThreadPool(){
+    {
+        std::lock_guard<std::mutex> guard(lock_);
+        stop_ = true;
+    }
+    wake_.notify_all();
+    for (auto& worker : workers_){
+        worker.join();
+    }
+}
+
+/**
+ * Runs task over [0, n) on the pool. If a task throws, the remaining
+ * indices are still run and the first exception is rethrown here.
+ */
+inline void ThreadPool::run(size_t n, std::function<void(size_t)> task){
+    std::lock_guard<std::mutex> turn(runLock_);
+    {
+        // A worker that woke too late for the last run may still be on
+        // its way out
+        std::unique_lock<std::mutex> guard(lock_);
+        finished_.wait(guard, [&]{ return active_ == 0; });
+        task_ = std::move(task);
+        count_ = n;
+        next_ = 0;
+        done_ = 0;
+        error_ = nullptr;
+        generation_++;
+    }
+    wake_.notify_all();
+    drain();
+
+    std::unique_lock<std::mutex> guard(lock_);
+    finished_.wait(guard, [&]{ return done_ == count_ && active_ == 0; });
+    task_ = nullptr;
+    if (error_){
+        std::rethrow_exception(error_);
+    }
+}
+
+/**
+ * Claims and runs indices of the current run until there are none left.
+ */
+inline void ThreadPool::drain(){
+    size_t ran = 0;
+    for (size_t i; (i = next_.fetch_add(1)) < count_; ran++){
+        try {
+            task_(i);
+        } catch (...){
+            std::lock_guard<std::mutex> guard(lock_);
+            if (!error_){
+                error_ = std::current_exception();
+            }
+        }
+    }
+    std::lock_guard<std::mutex> guard(lock_);
+    done_ += ran;
+}
+
+inline void ThreadPool::work(){
+    unsigned long seen = 0;
+    for (;;){
+        {
+            std::unique_lock<std::mutex> guard(lock_);
+            wake_.wait(guard, [&]{ return stop_ || generation_ != seen; });
+            if (stop_){
+                return;
+            }
+            seen = generation_;
+            active_++;
+        }
+        drain();
+
+        std::lock_guard<std::mutex> guard(lock_);
+        if (--active_ == 0 && done_ == count_){
+            finished_.notify_all();
+        }
+    }
+}
+
+#endif // THREAD_POOL_H_
@@ -0,0 +1,461 @@
+/*
+ * Copyright (C) 2013 Christian Briones
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense, 
+ * and/or sell copies of the Software, and to permit persons to whom the 
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included 
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, 
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES 
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR
+ * ANY CLAIM, DAMAGES, OR OTHER LIABILITY, WHETHER IN AN ACTION OF
+ * CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+ * WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef CONCURRENT_SKIP_LIST_H_
+#define CONCURRENT_SKIP_LIST_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <atomic>
+#include <new>
+
+#include "../hashmap/Epoch.h"
+
+/**
+ * Sorted set that any number of threads can insert into, erase from and
+ * read at once, without locks (Herlihy and Shavit's lock-free skip list,
+ * after Fraser).
+ *
+ * Every level is a linked list of the nodes tall enough to be part of it.
+ * A node is erased by setting a mark in the low bit of each of its next
+ * pointers, top level first: the mark at level 0 decides which eraser
+ * wins, and once it is set the node is no longer in the set. Marked nodes
+ * are then unlinked, level by level, by whichever thread comes across
+ * them while searching with a CAS on the predecessor's link; a link is
+ * never changed once marked, so a CAS can never attach anything to a node
+ * that is being erased.
+ *
+ * contains and iteration never write, never retry and never wait for
+ * another thread: they step over marked nodes instead of unlinking them.
+ * Nodes are deleted through Epoch, so a reader can hold on to any node it
+ * reached until it finishes.
+ *
+ * Like SkipList, each node is a single allocation holding the item and
+ * its tower of links.
+ */
+template <class Type, int MAX_LEVEL = 32>
+class ConcurrentSkipList {
+    static_assert(MAX_LEVEL >= 1 && MAX_LEVEL <= 64, "MAX_LEVEL must be between 1 and 64");
+public:
+    ConcurrentSkipList();
+    ~ConcurrentSkipList();
+
+    ConcurrentSkipList(const ConcurrentSkipList&) = delete;
+    ConcurrentSkipList& operator=(const ConcurrentSkipList&) = delete;
+
+    bool insert(const Type& item);
+    bool erase(const Type& item);
+    bool contains(const Type& item) const;
+
+    /**
+     * The number of items, which is only exact while no other thread is
+     * changing the list.
+     */
+    int size() const {
+        return size_.load(std::memory_order_relaxed);
+    }
+    bool empty() const {
+        return size() == 0;
+    }
+
+    template <class Function>
+    void for_each(Function f) const;
+
+    class Iterator;
+    Iterator begin() const;
+    Iterator end() const;
+private:
+    class Node;
+
+    // A pointer to the next node, with the low bit set once the node that
+    // holds the link is being erased
+    typedef std::atomic<uintptr_t> Link;
+
+    static Node* pointer(uintptr_t link){
+        return reinterpret_cast<Node*>(link & ~static_cast<uintptr_t>(1));
+    }
+    static bool marked(uintptr_t link){
+        return link & 1;
+    }
+    static uintptr_t link(const Node* node){
+        return reinterpret_cast<uintptr_t>(node);
+    }
+
+    bool find(const Type& item, Link** preds, Node** succs);
+    static Node* next(const Node* node);
+    static int random_level();
+
+    Link head_[MAX_LEVEL];
+    std::atomic<int> size_{0};
+};
+
+template <class Type, int MAX_LEVEL>
+class alignas(Type) alignas(uint64_t) ConcurrentSkipList<Type, MAX_LEVEL>::Node {
+public:
+    static Node* create(int height, const Type& data){
+        void* memory = ::operator new(sizeof(Node) + height * sizeof(Link));
+        Node* node;
+        try {
+            node = new (memory) Node(height, data);
+        } catch (...){
+            ::operator delete(memory);
+            throw;
+        }
+        for (int i = 0; i < height; i++){
+            new (&node->tower()[i]) Link(0);
+        }
+        return node;
+    }
+    static void destroy(void* memory){
+        Node* node = static_cast<Node*>(memory);
+        for (int i = 0; i < node->height; i++){
+            node->tower()[i].~Link();
+        }
+        node->~Node();
+        ::operator delete(memory);
+    }
+
+    /**
+     * Drops one of the node's two owners, its inserter and its eraser, and
+     * retires the node once both are done with it. Either may still be
+     * linking or unlinking the node's tower after the other has finished.
+     */
+    void release(){
+        if (owners.fetch_sub(1, std::memory_order_acq_rel) == 1){
+            Epoch::retire(this, &Node::destroy);
+        }
+    }
+
+    Link* tower(){
+        return reinterpret_cast<Link*>(this + 1);
+    }
+    const Link* tower() const {
+        return reinterpret_cast<const Link*>(this + 1);
+    }
+private:
+    Node(int height, const Type& data) : data(data), height(height) {}
+
+    Type data;
+    const int height;
+    std::atomic<int> owners{2};
+
+    friend class ConcurrentSkipList<Type, MAX_LEVEL>;
+};
+
+template <class Type, int MAX_LEVEL>
+ConcurrentSkipList<Type, MAX_LEVEL>::ConcurrentSkipList(){
+    for (int i = 0; i < MAX_LEVEL; i++){
+        head_[i].store(0, std::memory_order_relaxed);
+    }
+}
+
+/**
+ * Deletes every node. No other thread may be using the list.
+ */
+template <class Type, int MAX_LEVEL>
+ConcurrentSkipList<Type, MAX_LEVEL>::~ConcurrentSkipList(){
+    // Erased nodes are unlinked before they are retired, so every node
+    // still at level 0 belongs to the list
+    Node* ptr = pointer(head_[0].load(std::memory_order_acquire));
+    while (ptr){
+        Node* old = ptr;
+        ptr = pointer(ptr->tower()[0].load(std::memory_order_relaxed));
+
+        Node::destroy(old);
+    }
+}
+
+/*
+ * Returns the number of levels in a node over a geometric distribution
+ * with p = 1/2, in the range [1, MAX_LEVEL], from a per-thread generator.
+ */
+template <class Type, int MAX_LEVEL>
+int ConcurrentSkipList<Type, MAX_LEVEL>::random_level(){
+    static thread_local uint64_t random = 0;
+    if (!random){
+        random = (reinterpret_cast<uintptr_t>(&random) | 1) * 0x9e3779b97f4a7c15ull;
+    }
+    random ^= random << 13;
+    random ^= random >> 7;
+    random ^= random << 17;
+
+    return 1 + __builtin_ctzll(random | (uint64_t(1) << (MAX_LEVEL - 1)));
+}
+
+/**
+ * Finds, at every level, the last link before item and the first node
+ * not less than it, unlinking any marked nodes on the way. Returns true
+ * if that node at level 0 holds item.
+ */
+template <class Type, int MAX_LEVEL>
+bool ConcurrentSkipList<Type, MAX_LEVEL>::find(const Type& item, Link** preds, Node** succs){
+retry:
+    Link* pred = head_;
+    for (int level = MAX_LEVEL - 1; level >= 0; level--){
+        Node* curr = pointer(pred[level].load(std::memory_order_acquire));
+        while (curr){
+            uintptr_t succ = curr->tower()[level].load(std::memory_order_acquire);
+            while (marked(succ)){
+                // Unlink curr, which is being erased. If pred has changed
+                // since, or is being erased itself, start over
+                uintptr_t expected = link(curr);
+                if (!pred[level].compare_exchange_strong(expected, link(pointer(succ)))){
+                    goto retry;
+                }
+                curr = pointer(succ);
+                if (!curr){
+                    break;
+                }
+                succ = curr->tower()[level].load(std::memory_order_acquire);
+            }
+            if (!curr || !(curr->data < item)){
+                break;
+            }
+            pred = curr->tower();
+            curr = pointer(succ);
+        }
+        preds[level] = pred;
+        succs[level] = curr;
+    }
+    return succs[0] && succs[0]->data == item;
+}
+
+/**
+ * Inserts the item. Returns false if it was already in the list.
+ */
+template <class Type, int MAX_LEVEL>
+bool ConcurrentSkipList<Type, MAX_LEVEL>::insert(const Type& item){
+    Epoch::Guard guard;
+
+    Link* preds[MAX_LEVEL];
+    Node* succs[MAX_LEVEL];
+    int height = random_level();
+    Node* node = nullptr;
+
+    // The node is in the list once it is linked at level 0
+    while (true){
+        if (find(item, preds, succs)){
+            if (node){
+                Node::destroy(node);
+            }
+            return false;
+        }
+        if (!node){
+            node = Node::create(height, item);
+        }
+        for (int i = 0; i < height; i++){
+            node->tower()[i].store(link(succs[i]), std::memory_order_relaxed);
+        }
+        uintptr_t expected = link(succs[0]);
+        if (preds[0][0].compare_exchange_strong(expected, link(node))){
+            break;
+        }
+    }
+    size_.fetch_add(1, std::memory_order_relaxed);
+
+    // Then at every level above, bottom up, unless it is erased meanwhile
+    for (int level = 1; level < height; level++){
+        while (true){
+            uintptr_t next = node->tower()[level].load(std::memory_order_acquire);
+            if (marked(next)){
+                goto linked;
+            }
+            if (pointer(next) != succs[level] &&
+                    !node->tower()[level].compare_exchange_strong(next, link(succs[level]))){
+                // Only an eraser's mark changes the link under us
+                continue;
+            }
+            uintptr_t expected = link(succs[level]);
+            if (preds[level][level].compare_exchange_strong(expected, link(node))){
+                break;
+            }
+            if (!find(item, preds, succs) || succs[0] != node){
+                goto linked;
+            }
+        }
+    }
+linked:
+    // An eraser may have unlinked the node before the levels above were
+    // linked; unlink those too before letting go
+    if (marked(node->tower()[0].load(std::memory_order_seq_cst))){
+        find(item, preds, succs);
+    }
+    node->release();
+    return true;
+}
+
+/**
+ * Erases the item. Returns false if it was not in the list.
+ */
+template <class Type, int MAX_LEVEL>
+bool ConcurrentSkipList<Type, MAX_LEVEL>::erase(const Type& item){
+    Epoch::Guard guard;
+
+    Link* preds[MAX_LEVEL];
+    Node* succs[MAX_LEVEL];
+    if (!find(item, preds, succs)){
+        return false;
+    }
+    Node* node = succs[0];
+
+    // Freeze the links above level 0, so nothing new can follow the node
+    for (int level = node->height - 1; level >= 1; level--){
+        uintptr_t next = node->tower()[level].load(std::memory_order_acquire);
+        while (!marked(next) && !node->tower()[level].compare_exchange_weak(next, next | 1)){}
+    }
+
+    // Marking level 0 takes the node out of the set, for one eraser only
+    uintptr_t next = node->tower()[0].load(std::memory_order_acquire);
+    while (true){
+        if (marked(next)){
+            return false;
+        }
+        if (node->tower()[0].compare_exchange_weak(next, next | 1)){
+            break;
+        }
+    }
+    size_.fetch_sub(1, std::memory_order_relaxed);
+
+    // Pairs with the check at the end of insert: either the inserter sees
+    // the mark, or this search sees every level it linked
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    find(item, preds, succs);
+    node->release();
+    return true;
+}
+
+/**
+ * Returns true if the item is in the list.
+ */
+template <class Type, int MAX_LEVEL>
+bool ConcurrentSkipList<Type, MAX_LEVEL>::contains(const Type& item) const {
+    Epoch::Guard guard;
+
+    const Link* pred = head_;
+    Node* curr = nullptr;
+    for (int level = MAX_LEVEL - 1; level >= 0; level--){
+        curr = pointer(pred[level].load(std::memory_order_acquire));
+        while (curr){
+            uintptr_t succ = curr->tower()[level].load(std::memory_order_acquire);
+
+            // Step over nodes being erased
+            while (marked(succ)){
+                curr = pointer(succ);
+                if (!curr){
+                    break;
+                }
+                succ = curr->tower()[level].load(std::memory_order_acquire);
+            }
+            if (!curr || !(curr->data < item)){
+                break;
+            }
+            pred = curr->tower();
+            curr = pointer(succ);
+        }
+    }
+    return curr && curr->data == item;
+}
+
+/**
+ * The node after node at level 0 that is not being erased, or nullptr.
+ */
+template <class Type, int MAX_LEVEL>
+typename ConcurrentSkipList<Type, MAX_LEVEL>::Node* ConcurrentSkipList<Type, MAX_LEVEL>::next(const Node* node){
+    Node* curr = pointer(node->tower()[0].load(std::memory_order_acquire));
+    while (curr && marked(curr->tower()[0].load(std::memory_order_acquire))){
+        curr = pointer(curr->tower()[0].load(std::memory_order_acquire));
+    }
+    return curr;
+}
+
+/**
+ * Calls f on every item, in order. Items inserted or erased during the
+ * walk may or may not be seen.
+ */
+template <class Type, int MAX_LEVEL>
+template <class Function>
+void ConcurrentSkipList<Type, MAX_LEVEL>::for_each(Function f) const {
+    for (Iterator iter = begin(); iter != end(); ++iter){
+        f(*iter);
+    }
+}
+
+template <class Type, int MAX_LEVEL>
+typename ConcurrentSkipList<Type, MAX_LEVEL>::Iterator ConcurrentSkipList<Type, MAX_LEVEL>::begin() const {
+    return Iterator(*this);
+}
+
+template <class Type, int MAX_LEVEL>
+typename ConcurrentSkipList<Type, MAX_LEVEL>::Iterator ConcurrentSkipList<Type, MAX_LEVEL>::end() const {
+    return Iterator(*this, nullptr);
+}
+
+/**
+ * Iterator over the items in order, as for_each sees them. An iterator
+ * holds a Guard, so the node it is at stays valid however long it lives,
+ * but it also holds up deletion of everything erased meanwhile.
+ */
+template <class Type, int MAX_LEVEL>
+class ConcurrentSkipList<Type, MAX_LEVEL>::Iterator {
+public:
+    Iterator(const ConcurrentSkipList<Type, MAX_LEVEL>& list){
+        iter_ = pointer(list.head_[0].load(std::memory_order_acquire));
+        if (iter_ && marked(iter_->tower()[0].load(std::memory_order_acquire))){
+            iter_ = next(iter_);
+        }
+    }
+
+    Iterator(const ConcurrentSkipList<Type, MAX_LEVEL>&, Node* start){
+        iter_ = start;
+    }
+
+    Iterator operator++(){
+        if (iter_){
+            iter_ = next(iter_);
+        }
+        return (*this);
+    }
+
+    Iterator operator++(int){
+        Iterator old(*this);
+        ++(*this);
+        return old;
+    }
+
+    const Type& operator*(){
+        return iter_->data;
+    }
+
+    bool operator==(const Iterator& other){
+        return other.iter_ == iter_;
+    }
+
+    bool operator!=(const Iterator& other){
+        return other.iter_ != iter_;
+    }
+private:
+    Epoch::Guard guard_;
+    Node* iter_;
+};
+
+#endif // CONCURRENT_SKIP_LIST_H_
@@ -0,0 +1,94 @@
+/*
+ * Throughput of ConcurrentSkipList against a SkipList behind a
+ * reader-writer lock, for a read-mostly workload over a range of thread
+ * counts.
+ *
+ * Build with optimizations, e.g.
+ *     g++ -std=c++17 -O2 -pthread ConcurrentSkipListBench.cpp
+ */
+#include <iostream>
+#include <iomanip>
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <shared_mutex>
+#include <thread>
+#include <vector>
+#include <random>
+
+#include "ConcurrentSkipList.h"
+#include "SkipList.h"
+
+const int KEYS = 1 << 20;
+const int OPS_PER_THREAD = 1000000;
+const int WRITE_PERCENT = 10;
+
+// Keeps the compiler from dropping lookups whose result goes unused
+std::atomic<long> hits{0};
+
+/**
+ * Runs OPS_PER_THREAD operations on each of threads threads and returns
+ * the total throughput in millions of operations per second. Writes
+ * insert the key if it is missing, and op returns whether it was there.
+ */
+template <class Op>
+double run(int threads, Op op){
+    std::vector<std::thread> workers;
+    auto start = std::chrono::steady_clock::now();
+    for (int t = 0; t < threads; t++){
+        workers.emplace_back([t, &op]{
+            std::mt19937 rng(t);
+            std::uniform_int_distribution<int> key(0, KEYS - 1);
+            std::uniform_int_distribution<int> percent(0, 99);
+            long found = 0;
+            for (int i = 0; i < OPS_PER_THREAD; i++){
+                found += op(key(rng), percent(rng) < WRITE_PERCENT);
+            }
+            hits += found;
+        });
+    }
+    for (auto& w : workers){
+        w.join();
+    }
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    return threads * OPS_PER_THREAD / elapsed.count() / 1e6;
+}
+
+int main()
+{
+    int maxThreads = std::max(1u, std::thread::hardware_concurrency());
+
+    ConcurrentSkipList<int> lockFree;
+    SkipList<int> global;
+    std::shared_timed_mutex globalLock;
+    for (int i = 0; i < KEYS; i += 2){
+        lockFree.insert(i);
+        global.insert(i);
+    }
+
+    std::cout << "threads  rwlock+SkipList (Mops/s)  ConcurrentSkipList (Mops/s)" << std::endl;
+    for (int threads = 1; threads <= maxThreads; threads *= 2){
+        double locked = run(threads, [&](int key, bool write){
+            if (write){
+                std::lock_guard<std::shared_timed_mutex> guard(globalLock);
+                if (global.contains(key)){
+                    return true;
+                }
+                global.insert(key);
+                return false;
+            }
+            std::shared_lock<std::shared_timed_mutex> guard(globalLock);
+            return global.contains(key);
+        });
+        double concurrent = run(threads, [&](int key, bool write){
+            if (write){
+                return !lockFree.insert(key);
+            }
+            return lockFree.contains(key);
+        });
+        std::cout << std::setw(7) << threads
+            << std::setw(26) << std::fixed << std::setprecision(1) << locked
+            << std::setw(29) << concurrent << std::endl;
+    }
+    return 0;
+}
@@ -0,0 +1,173 @@
+#define BOOST_TEST_MODULE ConcurrentSkipList test
+
+#include <boost/test/unit_test.hpp>
+
+#include "ConcurrentSkipList.h"
+#include "../hashmap/Epoch.h"
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+BOOST_AUTO_TEST_CASE(single_thread_test) {
+    ConcurrentSkipList<int> list;
+    BOOST_CHECK(list.empty());
+    BOOST_CHECK(list.begin() == list.end());
+
+    const int TEST_SIZE = 1000;
+    for (int i = TEST_SIZE - 1; i >= 0; i--){
+        BOOST_CHECK(list.insert(i));
+    }
+    BOOST_CHECK(!list.insert(10));
+    BOOST_CHECK_EQUAL(list.size(), TEST_SIZE);
+
+    for (int i = 0; i < TEST_SIZE; i += 2){
+        BOOST_CHECK(list.erase(i));
+    }
+    BOOST_CHECK(!list.erase(0));
+    BOOST_CHECK(!list.erase(TEST_SIZE));
+    BOOST_CHECK_EQUAL(list.size(), TEST_SIZE / 2);
+
+    for (int i = -1; i <= TEST_SIZE; i++){
+        BOOST_CHECK_EQUAL(list.contains(i), i % 2 == 1);
+    }
+
+    int expected = 1;
+    for (auto iter = list.begin(); iter != list.end(); iter++){
+        BOOST_CHECK_EQUAL(*iter, expected);
+        expected += 2;
+    }
+    BOOST_CHECK_EQUAL(expected, TEST_SIZE + 1);
+
+    // Erased items can come back
+    BOOST_CHECK(list.insert(0));
+    BOOST_CHECK(list.contains(0));
+}
+
+BOOST_AUTO_TEST_CASE(concurrent_insert_test) {
+    ConcurrentSkipList<int> list;
+
+    // Every thread inserts every key; exactly one wins each
+    const int THREADS = 4;
+    const int TEST_SIZE = 5000;
+    std::atomic<int> inserted{0};
+    std::vector<std::thread> workers;
+    for (int t = 0; t < THREADS; t++){
+        workers.emplace_back([&, t]{
+            for (int i = 0; i < TEST_SIZE; i++){
+                int key = (i * 7 + t * 13) % TEST_SIZE;
+                if (list.insert(key)){
+                    inserted++;
+                }
+            }
+        });
+    }
+    for (auto& w : workers){
+        w.join();
+    }
+
+    BOOST_CHECK_EQUAL(inserted.load(), TEST_SIZE);
+    BOOST_CHECK_EQUAL(list.size(), TEST_SIZE);
+
+    int expected = 0;
+    list.for_each([&](int item){
+        BOOST_CHECK_EQUAL(item, expected);
+        expected++;
+    });
+    BOOST_CHECK_EQUAL(expected, TEST_SIZE);
+}
+
+BOOST_AUTO_TEST_CASE(concurrent_erase_test) {
+    ConcurrentSkipList<int> list;
+
+    // Half the threads insert and erase their own keys over and over while
+    // the rest read, so erased nodes are retired under live readers. The
+    // keys interleave, so neighbouring nodes churn at once
+    const int THREADS = 4;
+    const int KEYS = 1000;
+    const int ROUNDS = 20;
+    for (int i = 0; i < KEYS * THREADS; i += THREADS){
+        list.insert(i);
+    }
+
+    // Boost.Test assertions are not thread safe, so workers count failures
+    std::atomic<bool> done{false};
+    std::atomic<int> errors{0};
+    std::vector<std::thread> workers;
+    for (int t = 0; t < THREADS; t++){
+        workers.emplace_back([&, t]{
+            if (t % 2 == 0){
+                for (int round = 0; round < ROUNDS; round++){
+                    for (int i = t; i < KEYS * THREADS; i += THREADS){
+                        if (list.erase(i) != (round > 0 || t == 0)){
+                            errors++;
+                        }
+                    }
+                    for (int i = t; i < KEYS * THREADS; i += THREADS){
+                        if (!list.insert(i)){
+                            errors++;
+                        }
+                    }
+                }
+            } else {
+                while (!done.load()){
+                    int last = -1;
+                    list.for_each([&](int item){
+                        if (item <= last || item % 2 != 0){
+                            errors++;
+                        }
+                        last = item;
+                    });
+                    // Nobody ever inserts this thread's keys
+                    for (int i = t; i < KEYS * THREADS; i += 97 * THREADS){
+                        if (list.contains(i)){
+                            errors++;
+                        }
+                    }
+                }
+            }
+        });
+    }
+    for (int t = 0; t < THREADS; t += 2){
+        workers[t].join();
+    }
+    done = true;
+    for (int t = 1; t < THREADS; t += 2){
+        workers[t].join();
+    }
+
+    BOOST_CHECK_EQUAL(errors.load(), 0);
+    BOOST_CHECK_EQUAL(list.size(), 2 * KEYS);
+    for (int i = 0; i < KEYS * THREADS; i++){
+        BOOST_CHECK_EQUAL(list.contains(i), i % THREADS == 0 || i % THREADS == 2);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(epoch_test) {
+    static int destroyed = 0;
+    struct Counted {
+        static void destroy(void* object){
+            delete static_cast<int*>(object);
+            destroyed++;
+        }
+    };
+
+    // A Guard holds up reclamation however much is retired
+    const int TEST_SIZE = 1000;
+    size_t before = Epoch::pending();
+    {
+        Epoch::Guard guard;
+        for (int i = 0; i < TEST_SIZE; i++){
+            Epoch::retire(new int(i), &Counted::destroy);
+        }
+        BOOST_CHECK_EQUAL(destroyed, 0);
+        BOOST_CHECK_EQUAL(Epoch::pending(), before + TEST_SIZE);
+    }
+
+    // and once it is gone the epoch moves on and it all gets deleted
+    for (int i = 0; i < TEST_SIZE; i++){
+        Epoch::retire(new int(i), &Counted::destroy);
+    }
+    BOOST_CHECK_GE(destroyed, TEST_SIZE);
+    BOOST_CHECK_LT(Epoch::pending(), before + TEST_SIZE);
+}
@@ -23,235 +23,400 @@
 #ifndef SKIP_LIST_H_
 #define SKIP_LIST_H_
 
-#include <cstdlib>
-#include <cmath>
+#include <stddef.h>
+#include <stdint.h>
+
 #include <iostream>
+#include <new>
 #include <stdexcept>
 
 /**
- * Returns a number evenly distributed over the interval [0, 1]
+ * Sorted list with O(log n) search, insertion, erasure, indexing and
+ * ranking. Equal items are kept, next to each other.
+ *
+ * Every node is a single allocation: the item, followed by its tower of
+ * links, one per level the node is part of. Each link holds the next node
+ * at its level and its width, the number of level 0 steps it spans, which
+ * at(), rank() and count_between() add up to find positions.
+ *
+ * Node heights follow a geometric distribution with p = 1/2, up to
+ * MAX_LEVEL. Searches start from the tallest tower built so far, about
+ * log2(n) levels up, so the default MAX_LEVEL of 32 keeps searches
+ * logarithmic up to billions of items at no cost to small lists.
  */
-float frand(){
-    return static_cast<float>(rand()) / RAND_MAX;
-}
-
-template <class Type>
+template <class Type, int MAX_LEVEL = 32>
 class SkipList {
+    static_assert(MAX_LEVEL >= 1 && MAX_LEVEL <= 64, "MAX_LEVEL must be between 1 and 64");
 public:
     SkipList();
     ~SkipList();
-    
+
+    SkipList(const SkipList&) = delete;
+    SkipList& operator=(const SkipList&) = delete;
+
     void insert(const Type& item);
+    bool erase(const Type& item);
     bool contains(const Type& item) const;
     int size();
 
     bool empty(){ return empty_; };
 
     Type& at(int index);
+    int rank(const Type& item) const;
+    int count_between(const Type& lo, const Type& hi) const;
 
     class Iterator;
     Iterator begin();
     Iterator end();
+    Iterator lower_bound(const Type& item);
+    Iterator upper_bound(const Type& item);
+
+    class Range;
+    Range range(const Type& lo, const Type& hi);
 private:
+    class Node;
+
+    struct Link {
+        Node* next;
+        size_t width;
+    };
+
     int random_level();
+    size_t count_before(const Type& item, bool inclusive, Node** after) const;
 
-    class Node;
-    Node head_;
+    // The links out of the head, at every level up to level_
+    Link head_[MAX_LEVEL];
+    int level_ = 1;
 
     int size_ = 0;
     bool empty_ = true;
 
-    static const int MAX_LEVEL = 4;
-    static constexpr float LEVEL_DIST = 0.5;
+    uint64_t random_ = 0x9e3779b97f4a7c15ull;
 };
 
-template <class Type>
-class SkipList<Type>::Node {
+template <class Type, int MAX_LEVEL>
+class alignas(Type) alignas(typename SkipList<Type, MAX_LEVEL>::Link) SkipList<Type, MAX_LEVEL>::Node {
 public:
-    Node(int height) : height(height){
-        next = new Node * [height];
-        width = new size_t [height];
+    /**
+     * Allocates a node and its tower of height links, all unlinked.
+     */
+    static Node* create(int height, const Type& data){
+        void* memory = ::operator new(sizeof(Node) + height * sizeof(Link));
+        Node* node;
+        try {
+            node = new (memory) Node(height, data);
+        } catch (...){
+            ::operator delete(memory);
+            throw;
+        }
         for (int i = 0; i < height; i++){
-            next[i] = nullptr;
-            width[i] = 0;
+            node->tower()[i].next = nullptr;
+            node->tower()[i].width = 0;
         }
+        return node;
     }
-    Node(int height, const Type& data) : Node(height) {
-        this->data = data;
+    static void destroy(Node* node){
+        node->~Node();
+        ::operator delete(node);
     }
-    ~Node(){
-        delete[] next;
-        delete[] width;
+
+    // The links, laid out right after the node
+    Link* tower(){
+        return reinterpret_cast<Link*>(this + 1);
+    }
+    const Link* tower() const {
+        return reinterpret_cast<const Link*>(this + 1);
     }
 private:
-    Node** next;
-    const int height;
-    Type data;
+    Node(int height, const Type& data) : data(data), height(height) {}
 
-    size_t* width;
+    Type data;
+    const int height;
 
-    friend class SkipList<Type>;
+    friend class SkipList<Type, MAX_LEVEL>;
 };
 
 /**
  * SkipList Constructor
  */
-template <class Type>
-SkipList<Type>::SkipList() : head_(MAX_LEVEL) {}
+template <class Type, int MAX_LEVEL>
+SkipList<Type, MAX_LEVEL>::SkipList(){
+    head_[0].next = nullptr;
+    head_[0].width = 1;
+}
 
 /**
  * SkipList Destructor
  */
-template <class Type>
-SkipList<Type>::~SkipList(){
+template <class Type, int MAX_LEVEL>
+SkipList<Type, MAX_LEVEL>::~SkipList(){
     // Delete all nodes in the list
-    
-    Node* ptr = head_.next[0];
-    
+    Node* ptr = head_[0].next;
+
     while(ptr){
         Node* old = ptr;
-        ptr = ptr->next[0];
+        ptr = ptr->tower()[0].next;
 
-        delete old;
+        Node::destroy(old);
     }
 }
 
-template <class Type>
-inline int SkipList<Type>::size(){
+template <class Type, int MAX_LEVEL>
+inline int SkipList<Type, MAX_LEVEL>::size(){
     return size_;
 }
 
 /*
  * Returns the number of levels in a node over a geometric distribution
- * (i.e in the range [1, MAX_LEVEL]
+ * (i.e in the range [1, MAX_LEVEL]), one coin flip per bit of a random
+ * word.
  */
-template <class Type>
-int SkipList<Type>::random_level(){
+template <class Type, int MAX_LEVEL>
+int SkipList<Type, MAX_LEVEL>::random_level(){
+    random_ ^= random_ << 13;
+    random_ ^= random_ >> 7;
+    random_ ^= random_ << 17;
 
-    int lvl = 0;
-    while ((++lvl != MAX_LEVEL) && frand() < LEVEL_DIST){}
-
-    return lvl;
+    return 1 + __builtin_ctzll(random_ | (uint64_t(1) << (MAX_LEVEL - 1)));
 }
 
 /**
  * Inserts the item into the SkipList.
  */
-template <class Type>
-void SkipList<Type>::insert(const Type& item){
-    int index = 0;
-
+template <class Type, int MAX_LEVEL>
+void SkipList<Type, MAX_LEVEL>::insert(const Type& item){
     int levels = random_level();
-    Node* new_node = new Node(levels, item); 
-
-    Node* p = &head_;
-    Node* prev[MAX_LEVEL];
-    int prev_index[MAX_LEVEL];
-
-    for (int i = MAX_LEVEL - 1; i >= 0; i--){
-        // TODO:
-        // Update the index of the nodes in previous as well
-        // then since you know the old index + the index of the
-        // newly inserted item you can update the widths of the
-        // links
-        while (p->next[i] && p->next[i]->data < item){
-            index += p->width[i];
-            p = p->next[i];
+    Node* new_node = Node::create(levels, item);
+
+    // The head links to the end of the list at new levels. A width counts
+    // positions, with the head at 0 and the end at size_ + 1
+    for (; level_ < levels; level_++){
+        head_[level_].next = nullptr;
+        head_[level_].width = size_ + 1;
+    }
+
+    // The tower of the last node before the item at each level, and its
+    // position
+    Link* prev[MAX_LEVEL];
+    size_t prev_index[MAX_LEVEL];
+
+    Link* p = head_;
+    size_t index = 0;
+    for (int i = level_ - 1; i >= 0; i--){
+        while (p[i].next && p[i].next->data < item){
+            index += p[i].width;
+            p = p[i].next->tower();
         }
         // Save all of the pointers in the prev lists
         prev[i] = p;
         prev_index[i] = index;
     }
 
-    // Connect it into each list with the same level
+    // Connect it into each list with the same level, at position index + 1
+    Link* links = new_node->tower();
     for (int i = 0; i < levels; i++){
-        Node* after = prev[i]->next[i];
-        prev[i]->next[i] = new_node;
-        new_node->next[i] = after;
-        
-        // Update link widths
-        int old_width = prev[i]->width[i];
-        // "Cut"
-        prev[i]->width[i] = index - prev_index[i] + 1;
-        // Give "excess" to new node
-        new_node->width[i] = old_width - prev[i]->width[i];
+        Link& link = prev[i][i];
+        links[i].next = link.next;
+        link.next = new_node;
+
+        // Split the link's width, which now spans the new node as well
+        size_t old_width = link.width;
+        link.width = index + 1 - prev_index[i];
+        links[i].width = old_width + 1 - link.width;
+    }
+    // Links above the new node pass over it
+    for (int i = levels; i < level_; i++){
+        prev[i][i].width++;
     }
 
     ++size_;
     empty_ = false;
 }
 
-template <class Type>
-Type& SkipList<Type>::at(int index){
+/**
+ * Erases one copy of the item. Returns false if the item was not in the
+ * SkipList.
+ */
+template <class Type, int MAX_LEVEL>
+bool SkipList<Type, MAX_LEVEL>::erase(const Type& item){
+    // The tower of the last node before the item at each level
+    Link* prev[MAX_LEVEL];
+
+    Link* p = head_;
+    for (int i = level_ - 1; i >= 0; i--){
+        while (p[i].next && p[i].next->data < item){
+            p = p[i].next->tower();
+        }
+        prev[i] = p;
+    }
+
+    Node* node = p[0].next;
+    if (!node || !(node->data == item)){
+        return false;
+    }
+
+    // Bypass the node at each of its levels, joining the widths on either
+    // side of it
+    Link* links = node->tower();
+    for (int i = 0; i < node->height; i++){
+        Link& link = prev[i][i];
+        link.next = links[i].next;
+        link.width += links[i].width - 1;
+    }
+    // Links above the node no longer pass over it
+    for (int i = node->height; i < level_; i++){
+        prev[i][i].width--;
+    }
+    Node::destroy(node);
+
+    // Drop levels that no longer hold any node
+    while (level_ > 1 && !head_[level_ - 1].next){
+        level_--;
+    }
+
+    --size_;
+    empty_ = size_ == 0;
+    return true;
+}
+
+template <class Type, int MAX_LEVEL>
+Type& SkipList<Type, MAX_LEVEL>::at(int index){
 
     if (index >= size_ || index < 0){
         throw std::out_of_range("Index out of range [0, size) for skiplist ");
     }
 
-    Node* p = &head_;
+    Link* p = head_;
 
-    int p_index = 0;
-    for (int i = MAX_LEVEL - 1; i >= 0; i--){
-        // Equivalent to 
+    size_t p_index = 0;
+    for (int i = level_ - 1; i >= 0; i--){
+        // Equivalent to
         // while ( we don't overshoot )
         // just like with item search
-        while (p_index + p->width[i] <= index){
-            p_index += p->width[i];
-            p = p->next[i];
+        while (p_index + p[i].width <= static_cast<size_t>(index)){
+            p_index += p[i].width;
+            p = p[i].next->tower();
         }
     }
-    return p->next[0]->data;
+    return p[0].next->data;
 }
 
 /**
  * Returns true if the item is contained in the SkipList.
  */
-template <class Type>
-bool SkipList<Type>::contains(const Type& item) const {
-    if (empty_){
-        return false;
-    }
+template <class Type, int MAX_LEVEL>
+bool SkipList<Type, MAX_LEVEL>::contains(const Type& item) const {
+    const Link* p = head_;
 
-    const Node* p = &head_;
+    for (int i = level_ - 1; i >= 0; i--){
+        while (p[i].next && p[i].next->data < item){
+           p = p[i].next->tower();
+        }
+    }
+    const Node* next = p[0].next;
+    return next && next->data == item;
+}
 
-    for (int i = MAX_LEVEL; i >= 0; i--){
-        while (p->next[i] && p->next[i]->data <= item){
-           p = p->next[i]; 
+/*
+ * Returns the number of items less than item, or not greater than it if
+ * inclusive, adding up link widths on the way down. Sets after, if given,
+ * to the node following those items.
+ */
+template <class Type, int MAX_LEVEL>
+size_t SkipList<Type, MAX_LEVEL>::count_before(const Type& item, bool inclusive, Node** after) const {
+    const Link* p = head_;
+
+    size_t index = 0;
+    for (int i = level_ - 1; i >= 0; i--){
+        while (p[i].next && (inclusive ? !(item < p[i].next->data) : p[i].next->data < item)){
+            index += p[i].width;
+            p = p[i].next->tower();
         }
     }
-    return (p && p->data == item);
+    if (after){
+        *after = p[0].next;
+    }
+    return index;
+}
+
+/**
+ * Returns the number of items less than item, which is the index of the
+ * item if it is in the SkipList.
+ */
+template <class Type, int MAX_LEVEL>
+int SkipList<Type, MAX_LEVEL>::rank(const Type& item) const {
+    return count_before(item, false, nullptr);
+}
+
+/**
+ * Returns the number of items in [lo, hi).
+ */
+template <class Type, int MAX_LEVEL>
+int SkipList<Type, MAX_LEVEL>::count_between(const Type& lo, const Type& hi) const {
+    if (!(lo < hi)){
+        return 0;
+    }
+    return count_before(hi, false, nullptr) - count_before(lo, false, nullptr);
+}
+
+/**
+ * Returns an iterator to the first item not less than item, or end().
+ */
+template <class Type, int MAX_LEVEL>
+typename SkipList<Type, MAX_LEVEL>::Iterator SkipList<Type, MAX_LEVEL>::lower_bound(const Type& item){
+    Node* node;
+    count_before(item, false, &node);
+    return Iterator(*this, node);
+}
+
+/**
+ * Returns an iterator to the first item greater than item, or end().
+ */
+template <class Type, int MAX_LEVEL>
+typename SkipList<Type, MAX_LEVEL>::Iterator SkipList<Type, MAX_LEVEL>::upper_bound(const Type& item){
+    Node* node;
+    count_before(item, true, &node);
+    return Iterator(*this, node);
+}
+
+/**
+ * Returns the items in [lo, hi), in order, for a range-based for loop.
+ */
+template <class Type, int MAX_LEVEL>
+typename SkipList<Type, MAX_LEVEL>::Range SkipList<Type, MAX_LEVEL>::range(const Type& lo, const Type& hi){
+    if (!(lo < hi)){
+        return Range(end(), end());
+    }
+    return Range(lower_bound(lo), lower_bound(hi));
 }
 
-template <class Type>
-typename SkipList<Type>::Iterator SkipList<Type>::begin(){
+template <class Type, int MAX_LEVEL>
+typename SkipList<Type, MAX_LEVEL>::Iterator SkipList<Type, MAX_LEVEL>::begin(){
     return Iterator(*this);
 }
 
-template <class Type>
-typename SkipList<Type>::Iterator SkipList<Type>::end(){
+template <class Type, int MAX_LEVEL>
+typename SkipList<Type, MAX_LEVEL>::Iterator SkipList<Type, MAX_LEVEL>::end(){
     return Iterator(*this, nullptr);
 }
 
 /**
  * Iterator class for traversing the SkipList
  */
-template <class Type>
-class SkipList<Type>::Iterator {
+template <class Type, int MAX_LEVEL>
+class SkipList<Type, MAX_LEVEL>::Iterator {
 public:
-    Iterator(const SkipList<Type>& list){
-        iter_ = list.head_.next[0];
+    Iterator(const SkipList<Type, MAX_LEVEL>& list){
+        iter_ = list.head_[0].next;
     }
 
-    Iterator(const SkipList<Type>& list, Node* start){
+    Iterator(const SkipList<Type, MAX_LEVEL>&, Node* start){
         iter_ = start;
-        if (iter_ == &list.head_){
-            iter_ = list.head_.next[0];
-        }
     }
 
     Iterator operator++(){
         if (iter_){
-            iter_ = iter_->next[0];
+            iter_ = iter_->tower()[0].next;
         }
         return (*this);
     }
@@ -277,4 +442,24 @@ private:
     Node* iter_;
 };
 
+/**
+ * A pair of iterators bounding part of the SkipList.
+ */
+template <class Type, int MAX_LEVEL>
+class SkipList<Type, MAX_LEVEL>::Range {
+public:
+    Range(const Iterator& first, const Iterator& last) : first_(first), last_(last) {}
+
+    Iterator begin() const {
+        return first_;
+    }
+
+    Iterator end() const {
+        return last_;
+    }
+private:
+    Iterator first_;
+    Iterator last_;
+};
+
 #endif // SKIP_LIST_H_
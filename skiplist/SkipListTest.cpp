@@ -125,3 +125,210 @@ BOOST_AUTO_TEST_CASE(is_sorted_test){
         last = c;
     }
 }
+
+BOOST_AUTO_TEST_CASE(random_index_test){
+    // Link widths must stay right wherever items land, at every level
+    const int TEST_SIZE = 10000;
+
+    std::vector<int> numbers(TEST_SIZE);
+    for (int i = 0; i < TEST_SIZE; i++){
+        numbers[i] = 3 * i;
+    }
+    std::random_shuffle(numbers.begin(), numbers.end());
+
+    SkipList<int> slist;
+    for (auto x : numbers){
+        slist.insert(x);
+    }
+    for (int i = 0; i < TEST_SIZE; i++){
+        BOOST_REQUIRE_EQUAL(slist.at(i), 3 * i);
+        BOOST_REQUIRE(slist.contains(3 * i));
+        BOOST_REQUIRE(!slist.contains(3 * i + 1));
+    }
+    BOOST_CHECK(!slist.contains(-1));
+    BOOST_CHECK_THROW(slist.at(TEST_SIZE), std::out_of_range);
+}
+
+BOOST_AUTO_TEST_CASE(max_level_test){
+    // A single level is a sorted linked list
+    SkipList<int, 1> flat;
+    for (int i = 100; i > 0; i--){
+        flat.insert(i);
+    }
+    BOOST_CHECK_EQUAL(flat.at(0), 1);
+    BOOST_CHECK_EQUAL(flat.at(99), 100);
+    BOOST_CHECK(flat.contains(50));
+}
+
+struct Score {
+    explicit Score(int points) : points(points) {}
+    int points;
+
+    bool operator<(const Score& other) const { return points < other.points; }
+    bool operator==(const Score& other) const { return points == other.points; }
+};
+
+BOOST_AUTO_TEST_CASE(no_default_constructor_test){
+    SkipList<Score> slist;
+    slist.insert(Score(3));
+    slist.insert(Score(1));
+    slist.insert(Score(2));
+
+    BOOST_CHECK(slist.contains(Score(2)));
+    BOOST_CHECK(!slist.contains(Score(4)));
+    BOOST_CHECK_EQUAL(slist.at(0).points, 1);
+}
+
+BOOST_AUTO_TEST_CASE(contains_edge_test){
+    // Searches start at the top level in use, never past the head's links
+    SkipList<int, 4> slist;
+    BOOST_CHECK(!slist.contains(0));
+
+    slist.insert(5);
+    BOOST_CHECK(slist.contains(5));
+    BOOST_CHECK(!slist.contains(4));
+    BOOST_CHECK(!slist.contains(6));
+
+    for (int i = 0; i < 1000; i++){
+        slist.insert(2 * i);
+    }
+    BOOST_CHECK(slist.contains(0));
+    BOOST_CHECK(slist.contains(1998));
+    BOOST_CHECK(!slist.contains(1999));
+    BOOST_CHECK(!slist.contains(-1));
+}
+
+BOOST_AUTO_TEST_CASE(erase_test){
+    const int TEST_SIZE = 2000;
+
+    std::vector<int> numbers(TEST_SIZE);
+    for (int i = 0; i < TEST_SIZE; i++){
+        numbers[i] = i;
+    }
+    std::random_shuffle(numbers.begin(), numbers.end());
+
+    SkipList<int> slist;
+    for (auto x : numbers){
+        slist.insert(x);
+    }
+    BOOST_CHECK(!slist.erase(TEST_SIZE));
+
+    // Erase the odd numbers in random order; the widths must still index
+    // the list
+    std::random_shuffle(numbers.begin(), numbers.end());
+    for (auto x : numbers){
+        if (x % 2 == 1){
+            BOOST_REQUIRE(slist.erase(x));
+        }
+    }
+    BOOST_CHECK(!slist.erase(1));
+    BOOST_CHECK_EQUAL(slist.size(), TEST_SIZE / 2);
+    for (int i = 0; i < TEST_SIZE / 2; i++){
+        BOOST_REQUIRE_EQUAL(slist.at(i), 2 * i);
+        BOOST_REQUIRE(!slist.contains(2 * i + 1));
+    }
+
+    // One copy at a time
+    slist.insert(10);
+    BOOST_CHECK(slist.erase(10));
+    BOOST_CHECK(slist.contains(10));
+
+    for (int i = 0; i < TEST_SIZE; i += 2){
+        BOOST_REQUIRE(slist.erase(i));
+    }
+    BOOST_CHECK(slist.empty());
+    BOOST_CHECK(slist.begin() == slist.end());
+
+    // The emptied list is still usable
+    slist.insert(7);
+    slist.insert(3);
+    BOOST_CHECK_EQUAL(slist.at(0), 3);
+    BOOST_CHECK_EQUAL(slist.at(1), 7);
+}
+
+BOOST_AUTO_TEST_CASE(bound_test){
+    SkipList<int> slist;
+    BOOST_CHECK(slist.lower_bound(0) == slist.end());
+
+    // 0, 10, 10, 20, ..., 90
+    for (int i = 0; i < 10; i++){
+        slist.insert(10 * i);
+    }
+    slist.insert(10);
+
+    BOOST_CHECK_EQUAL(*slist.lower_bound(10), 10);
+    BOOST_CHECK_EQUAL(*slist.upper_bound(10), 20);
+    BOOST_CHECK_EQUAL(*slist.lower_bound(15), 20);
+    BOOST_CHECK_EQUAL(*slist.upper_bound(15), 20);
+    BOOST_CHECK_EQUAL(*slist.lower_bound(-5), 0);
+    BOOST_CHECK(slist.lower_bound(91) == slist.end());
+    BOOST_CHECK(slist.upper_bound(90) == slist.end());
+
+    int count = 0;
+    for (auto iter = slist.lower_bound(10); iter != slist.upper_bound(10); iter++){
+        BOOST_CHECK_EQUAL(*iter, 10);
+        count++;
+    }
+    BOOST_CHECK_EQUAL(count, 2);
+}
+
+BOOST_AUTO_TEST_CASE(range_test){
+    SkipList<int> slist;
+    for (int i = 0; i < 100; i++){
+        slist.insert(3 * i);
+    }
+
+    std::vector<int> seen;
+    for (auto x : slist.range(10, 31)){
+        seen.push_back(x);
+    }
+    BOOST_CHECK((seen == std::vector<int>{12, 15, 18, 21, 24, 27, 30}));
+
+    // Half open
+    seen.clear();
+    for (auto x : slist.range(12, 30)){
+        seen.push_back(x);
+    }
+    BOOST_CHECK_EQUAL(seen.size(), 6);
+    BOOST_CHECK_EQUAL(seen.front(), 12);
+    BOOST_CHECK_EQUAL(seen.back(), 27);
+
+    auto empty = slist.range(30, 12);
+    BOOST_CHECK(empty.begin() == empty.end());
+    auto past = slist.range(1000, 2000);
+    BOOST_CHECK(past.begin() == past.end());
+}
+
+BOOST_AUTO_TEST_CASE(rank_test){
+    const int TEST_SIZE = 5000;
+
+    std::vector<int> numbers(TEST_SIZE);
+    for (int i = 0; i < TEST_SIZE; i++){
+        numbers[i] = 2 * i;
+    }
+    std::random_shuffle(numbers.begin(), numbers.end());
+
+    SkipList<int> slist;
+    for (auto x : numbers){
+        slist.insert(x);
+    }
+    for (int i = 0; i < TEST_SIZE; i++){
+        BOOST_REQUIRE_EQUAL(slist.rank(2 * i), i);
+        BOOST_REQUIRE_EQUAL(slist.rank(2 * i + 1), i + 1);
+    }
+    BOOST_CHECK_EQUAL(slist.rank(-1), 0);
+
+    BOOST_CHECK_EQUAL(slist.count_between(0, 2 * TEST_SIZE), TEST_SIZE);
+    BOOST_CHECK_EQUAL(slist.count_between(10, 20), 5);
+    BOOST_CHECK_EQUAL(slist.count_between(11, 20), 4);
+    BOOST_CHECK_EQUAL(slist.count_between(20, 10), 0);
+    BOOST_CHECK_EQUAL(slist.count_between(-100, 0), 0);
+
+    // Ranks follow erasures
+    for (int i = 0; i < TEST_SIZE; i += 2){
+        slist.erase(2 * i);
+    }
+    BOOST_CHECK_EQUAL(slist.rank(2 * TEST_SIZE), TEST_SIZE / 2);
+    BOOST_CHECK_EQUAL(slist.rank(6), 1);
+    BOOST_CHECK_EQUAL(slist.count_between(0, 20), 5);
+}